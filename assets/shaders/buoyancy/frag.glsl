@@ -0,0 +1,17 @@
+#version 430 core
+
+out vec4 color;
+
+in VS_OUT {
+    vec3 position_world_space;
+    vec3 normal;
+} fs_in;
+
+float calc_lighting(vec3 normal) {
+    const vec3 light_direction = normalize(vec3(.3, -1, .2));
+    return max(dot(normalize(normal), -light_direction), .2);
+}
+
+void main() {
+    color = vec4(calc_lighting(fs_in.normal) * vec3(.9, .45, .1), 1.);
+}
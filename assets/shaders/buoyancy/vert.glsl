@@ -0,0 +1,49 @@
+#version 430 core
+
+#include "../common/frame_data.glsl"
+
+// mirrors Game::Buoyancy::Instance, one per body
+struct Instance {
+    vec4 position_scale;
+    vec4 orientation;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+out VS_OUT {
+    vec3 position_world_space;
+    vec3 normal;
+} vs_out;
+
+const vec3 FACE_NORMALS[6] = vec3[](
+    vec3( 1, 0, 0), vec3(-1, 0, 0),
+    vec3( 0, 1, 0), vec3( 0,-1, 0),
+    vec3( 0, 0, 1), vec3( 0, 0,-1)
+);
+
+// two counter-clockwise triangles per face in its (u, v) frame
+const vec2 FACE_CORNERS[6] = vec2[](
+    vec2(-1,-1), vec2( 1,-1), vec2( 1, 1),
+    vec2(-1,-1), vec2( 1, 1), vec2(-1, 1)
+);
+
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2. * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// 36 attribute-less vertices of a unit cube, the instance places and orients it
+void main() {
+    Instance instance = instances[gl_InstanceID];
+
+    vec3 normal = FACE_NORMALS[gl_VertexID / 6];
+    vec3 u = normal.yzx;
+    vec3 v = cross(normal, u);
+    vec2 corner = FACE_CORNERS[gl_VertexID % 6];
+    vec3 position = .5 * (normal + u * corner.x + v * corner.y);
+
+    vs_out.normal = rotate(instance.orientation, normal);
+    vs_out.position_world_space = instance.position_scale.xyz + rotate(instance.orientation, position * instance.position_scale.w);
+    gl_Position = projection * view * vec4(vs_out.position_world_space, 1.);
+}
@@ -0,0 +1,7 @@
+// mirrors Game::FrameData, bound by the renderer once per frame
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 camera_position;
+    float time;
+};
@@ -0,0 +1,11 @@
+// mirrors Game::Ocean's cascades, set by the renderer before every ocean draw. the displacement, slope and foam array
+// textures hold two layers per cascade: cascade_layers[i] has its current state and cascade_layers[i] ^ 1 its previous
+const int MAX_CASCADES = 4;
+
+uniform int cascade_count;
+uniform float cascade_patch_sizes[MAX_CASCADES];
+uniform int cascade_layers[MAX_CASCADES];
+// wavenumber where each cascade's band starts, 0 for the first, which reaches down to the longest waves
+uniform float cascade_band_starts[MAX_CASCADES];
+// fixed-step interpolation from each cascade's previous towards its current state
+uniform float cascade_blends[MAX_CASCADES];
@@ -0,0 +1,46 @@
+// the displacement lookup mirrored on the cpu by WaveQuery: manual bilinear fetches with repeat wrapping and an explicit
+// lerp instead of the texture units, summed over the cascades in the same order of operations, so both sides agree on
+// where the surface is. the cpu builds without fp contraction; `precise` keeps the compiler from fusing these into fmas
+
+float wave_lerp(float a, float b, float t) {
+    precise float result = a + (b - a) * t;
+    return result;
+}
+
+vec3 wave_lerp(vec3 a, vec3 b, float t) {
+    precise vec3 result = a + (b - a) * t;
+    return result;
+}
+
+vec2 wave_lerp(vec2 a, vec2 b, float t) {
+    precise vec2 result = a + (b - a) * t;
+    return result;
+}
+
+vec3 sample_wave_displacement(sampler2DArray displacement_map, int layer, vec2 position, float patch_size) {
+    ivec2 size = textureSize(displacement_map, 0).xy;
+    precise vec2 texel = position / patch_size * vec2(size) - .5;
+    vec2 base = floor(texel);
+    precise vec2 t = texel - base;
+
+    ivec2 mask = size - 1;
+    ivec2 i0 = ivec2(base) & mask;
+    ivec2 i1 = (i0 + 1) & mask;
+
+    vec3 d00 = texelFetch(displacement_map, ivec3(i0.x, i0.y, layer), 0).xyz;
+    vec3 d10 = texelFetch(displacement_map, ivec3(i1.x, i0.y, layer), 0).xyz;
+    vec3 d01 = texelFetch(displacement_map, ivec3(i0.x, i1.y, layer), 0).xyz;
+    vec3 d11 = texelFetch(displacement_map, ivec3(i1.x, i1.y, layer), 0).xyz;
+    return wave_lerp(wave_lerp(d00, d10, t.x), wave_lerp(d01, d11, t.x), t.y);
+}
+
+// trilinear through the texture unit: the slope only shades, so it follows the fragment's footprint down the mip chain
+// rather than matching WaveQuery's level 0 lookup. needs the implicit derivatives of a fragment shader
+vec2 sample_wave_slope(sampler2DArray slope_map, int layer, vec2 position, float patch_size) {
+    return texture(slope_map, vec3(position / patch_size, layer)).xy;
+}
+
+vec3 wave_normal(vec2 slope) {
+    float magnitude = sqrt(slope.x * slope.x + 1. + slope.y * slope.y);
+    return vec3(-slope.x, 1., -slope.y) / magnitude;
+}
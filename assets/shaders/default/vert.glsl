@@ -2,9 +2,9 @@
 
 layout (location = 0) in vec3 vertex;
 
+#include "../common/frame_data.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main() {
     gl_Position = projection  * view * model * vec4(vertex, 1.0);
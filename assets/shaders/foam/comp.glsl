@@ -0,0 +1,38 @@
+#version 430 core
+
+layout (local_size_x = 16, local_size_y = 16) in;
+
+layout (binding = 0) uniform sampler2DArray displacement_map;
+layout (binding = 0, r16f) uniform image2DArray foam_image;
+
+// the current layer of the cascade this dispatch runs for; its previous one is layer ^ 1
+uniform int layer;
+// world-space distance between two texels of the cascade, its patch size / resolution
+uniform float texel_size;
+// jacobian below which the surface is folded enough to break
+uniform float foam_threshold;
+// fraction of the previous coverage left after this step, exp(-interval / lifetime)
+uniform float foam_decay;
+
+// one dispatch per uploaded cascade state: the jacobian of the new displacement, injected into the decayed coverage of
+// the last one
+void main() {
+    ivec2 size = textureSize(displacement_map, 0).xy;
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, size))) return;
+
+    vec2 right = texelFetch(displacement_map, ivec3((texel + ivec2(1, 0)) % size, layer), 0).xz;
+    vec2 left = texelFetch(displacement_map, ivec3((texel + ivec2(size.x - 1, 0)) % size, layer), 0).xz;
+    vec2 up = texelFetch(displacement_map, ivec3((texel + ivec2(0, 1)) % size, layer), 0).xz;
+    vec2 down = texelFetch(displacement_map, ivec3((texel + ivec2(0, size.y - 1)) % size, layer), 0).xz;
+
+    vec2 d_dx = (right - left) / (2. * texel_size);
+    vec2 d_dz = (up - down) / (2. * texel_size);
+
+    // the horizontal displacement folds the surface where its jacobian drops towards zero
+    float jacobian = (1. + d_dx.x) * (1. + d_dz.y) - d_dx.y * d_dz.x;
+    float fresh = clamp((foam_threshold - jacobian) / max(foam_threshold, 1e-3), 0., 1.);
+
+    float previous = imageLoad(foam_image, ivec3(texel, layer ^ 1)).r;
+    imageStore(foam_image, ivec3(texel, layer), vec4(max(previous * foam_decay, fresh)));
+}
@@ -0,0 +1,13 @@
+#version 430 core
+
+#include "../common/frame_data.glsl"
+
+// homogeneous world-space point on the far plane, divided per fragment
+out vec4 far_point;
+
+void main() {
+    // one triangle covering the screen, generated from the vertex id so no buffers are bound
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2. - 1.;
+    far_point = inverse(projection * view) * vec4(position, 1., 1.);
+    gl_Position = vec4(position, 0., 1.);
+}
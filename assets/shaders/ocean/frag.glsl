@@ -1,10 +1,18 @@
 #version 430 core
 
+layout (binding = 1) uniform sampler2DArray slope_map;
+layout (binding = 2) uniform sampler2DArray foam_map;
+
+#include "../common/ocean_cascades.glsl"
+#include "../common/wave_sampling.glsl"
+
+uniform float foam_enabled;
+
 out vec4 color;
 
 in VS_OUT  {
     vec3 position_world_space;
-    vec3 normal;
+    vec2 surface_position;
 } fs_in;
 
 float calc_lighting(vec3 normal) {
@@ -13,7 +21,34 @@ float calc_lighting(vec3 normal) {
     return result;
 }
 
+// every cascade's slope at the fragment's footprint, blended between its states and summed like the displacement
+vec3 surface_normal(vec2 position) {
+    vec2 slope = vec2(0.);
+    for (int i = 0; i < cascade_count; i++) {
+        int layer = cascade_layers[i];
+        slope += wave_lerp(
+            sample_wave_slope(slope_map, layer ^ 1, position, cascade_patch_sizes[i]),
+            sample_wave_slope(slope_map, layer, position, cascade_patch_sizes[i]),
+            cascade_blends[i]
+        );
+    }
+    return wave_normal(slope);
+}
+
+// accumulated coverage thins out into streaks as it decays, fresh breaking water stays solid. every cascade folds its
+// own band of waves, the foam layers are paired with their displacement states like in the vertex shader
+float foam_coverage(vec2 position) {
+    float foam = 0.;
+    for (int i = 0; i < cascade_count; i++) {
+        vec2 uv = position / cascade_patch_sizes[i];
+        int layer = cascade_layers[i];
+        foam = max(foam, mix(texture(foam_map, vec3(uv, layer ^ 1)).r, texture(foam_map, vec3(uv, layer)).r, cascade_blends[i]));
+    }
+    return smoothstep(.05, .6, foam);
+}
+
 void main() {
-    float lighting = calc_lighting(fs_in.normal); 
-    color = vec4(lighting * vec3(0, 0, 1), 1.f);
-}
\ No newline at end of file
+    float lighting = calc_lighting(surface_normal(fs_in.surface_position));
+    float foam = foam_enabled * foam_coverage(fs_in.surface_position);
+    color = vec4(lighting * mix(vec3(0, 0, 1), vec3(.95, .97, 1), foam), 1.f);
+}
@@ -1,38 +1,81 @@
 #version 430 core
 
-layout (location = 0) in vec3 vertex;
+layout (binding = 0) uniform sampler2DArray displacement_map;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float time;
+#include "../common/frame_data.glsl"
+#include "../common/ocean_cascades.glsl"
+#include "../common/wave_sampling.glsl"
+
+uniform vec2 clipmap_origin;
+uniform float clipmap_cell_size;
+uniform float clipmap_grid_size;
 
 out VS_OUT  {
     vec3 position_world_space;
-    vec3 normal;
+    // where the vertex sits before the waves move it, which every cascade's tile is looked up with
+    vec2 surface_position;
 } vs_out;
 
+// `spacing` is the distance between the vertices around it, which doubles as they morph onto the coarser level's lattice
+vec2 clipmap_position(vec2 grid, out float spacing) {
+    vec2 position = clipmap_origin + grid * clipmap_cell_size;
+
+    // odd vertices slide onto their even neighbours towards the level's edge, where they meet the coarser level
+    float morph_end = .5 * clipmap_grid_size - 2.;
+    float morph_start = morph_end - .125 * clipmap_grid_size;
+    vec2 distance = abs(position - camera_position.xz) / clipmap_cell_size;
+    float morph = clamp((max(distance.x, distance.y) - morph_start) / (morph_end - morph_start), 0., 1.);
+
+    grid -= fract(grid * .5) * 2. * morph;
+    spacing = clipmap_cell_size * (1. + morph);
+    return clipmap_origin + grid * clipmap_cell_size;
+}
+
+// a cascade fades out of the geometry once its longest waves get fewer than four vertices, and is gone at two, where
+// point sampling its texels would only alias into noise; the fragments still shade it from the slope. it depends on the
+// spacing alone, so both sides of a level's edge agree on it
+float cascade_vertex_weight(int cascade, float spacing) {
+    if (cascade_band_starts[cascade] <= 0.) return 1.;
+    float wavelength = 2. * 3.14159265 / cascade_band_starts[cascade];
+    return 1. - smoothstep(.25 * wavelength, .5 * wavelength, spacing);
+}
+
+// the index buffer holds lattice positions z * (grid_size + 1) + x, which come back here as gl_VertexID
+vec2 lattice_position() {
+    uint row = uint(clipmap_grid_size) + 1u;
+    uint id = uint(gl_VertexID);
+    return vec2(id % row, id / row);
+}
+
 void main() {
-    vec3 normal;
     vec4 position_world_space;
+    vec2 surface_position;
+    float spacing;
 
     {
-        position_world_space = model * vec4(vertex, 1.0);
-        float b = position_world_space.x + time;
-        position_world_space.y = sin(b);
-        normal = normalize(
-            vec3(
-                -cos(b),
-                1,
-                0
-            )
-        );
+        surface_position = clipmap_position(lattice_position(), spacing);
+        position_world_space = vec4(surface_position.x, 0, surface_position.y, 1.0);
+
+        // only the displacement: the normal is shaded per fragment from the mipmapped slope, so the mesh can stay coarse
+        precise vec3 displacement = vec3(0.);
+        for (int i = 0; i < cascade_count; i++) {
+            float weight = cascade_vertex_weight(i, spacing);
+            if (weight <= 0.) continue;
+
+            int layer = cascade_layers[i];
+            displacement += weight * wave_lerp(
+                sample_wave_displacement(displacement_map, layer ^ 1, surface_position, cascade_patch_sizes[i]),
+                sample_wave_displacement(displacement_map, layer, surface_position, cascade_patch_sizes[i]),
+                cascade_blends[i]
+            );
+        }
+        position_world_space.xyz += displacement;
     }
 
     {
         vs_out.position_world_space = position_world_space.xyz;
-        vs_out.normal = normal;
+        vs_out.surface_position = surface_position;
     }
     
     gl_Position = projection  * view * position_world_space;
-}
\ No newline at end of file
+}
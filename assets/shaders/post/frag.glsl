@@ -0,0 +1,22 @@
+#version 430 core
+
+layout (binding = 0) uniform sampler2D scene_color;
+
+// the image fills the lower-left `source_extent` texels of its bucket sized target and is stretched over the output,
+// which samples texel centres exactly when both are the same size
+uniform vec2 source_extent;
+uniform vec2 output_size;
+
+out vec4 color;
+
+// narkowicz's fit of the aces filmic curve
+vec3 tonemap(vec3 x) {
+    return clamp((x * (2.51 * x + .03)) / (x * (2.43 * x + .59) + .14), 0., 1.);
+}
+
+void main() {
+    // kept half a texel inside the image, so the bilinear footprint never reaches the stale texels past it
+    vec2 position = clamp(gl_FragCoord.xy / output_size * source_extent, vec2(.5), source_extent - .5);
+    vec3 hdr = texture(scene_color, position / vec2(textureSize(scene_color, 0))).rgb;
+    color = vec4(tonemap(hdr), 1.);
+}
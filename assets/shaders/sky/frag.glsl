@@ -0,0 +1,20 @@
+#version 430 core
+
+#include "../common/frame_data.glsl"
+
+in vec4 far_point;
+
+out vec4 color;
+
+void main() {
+    vec3 direction = normalize(far_point.xyz / far_point.w - camera_position);
+
+    const vec3 zenith = vec3(.18, .38, .72);
+    const vec3 horizon = vec3(.72, .82, .92);
+    const vec3 ground = vec3(.08, .14, .22);
+
+    vec3 sky = direction.y > 0.
+        ? mix(horizon, zenith, pow(direction.y, .45))
+        : mix(horizon, ground, pow(-direction.y, .3));
+    color = vec4(sky, 1.);
+}
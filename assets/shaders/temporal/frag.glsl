@@ -0,0 +1,56 @@
+#version 430 core
+
+layout (binding = 0) uniform sampler2D scene_color;
+layout (binding = 1) uniform sampler2D scene_depth;
+layout (binding = 2) uniform sampler2D history;
+
+// texels of the bucket sized targets that hold the image: the scene at the render scale, the history at the viewport's
+uniform vec2 scene_extent;
+uniform vec2 output_size;
+// sub-pixel offset the scene was rendered with, in scene texels
+uniform vec2 jitter;
+// this frame's unjittered ndc and depth to last frame's clip space
+uniform mat4 reprojection;
+// 0 starts the history over
+uniform float history_weight;
+
+out vec4 color;
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / output_size;
+    // where the pixel's centre landed in the jittered scene
+    vec2 scene_position = uv * scene_extent + jitter;
+    ivec2 last = ivec2(scene_extent) - 1;
+    ivec2 nearest = clamp(ivec2(floor(scene_position)), ivec2(0), last);
+
+    // the jitter can push the lookup past the image, whose bucket sized target holds stale texels beyond it
+    vec2 current_position = clamp(scene_position, vec2(.5), scene_extent - .5);
+    vec3 current = texture(scene_color, current_position / vec2(textureSize(scene_color, 0))).rgb;
+
+    // the history is only trusted within the colours around it, and reprojected with the closest depth around it so
+    // silhouettes move with the surface in front
+    vec3 low = current;
+    vec3 high = current;
+    float depth = 1.;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            ivec2 texel = clamp(nearest + ivec2(x, y), ivec2(0), last);
+            vec3 neighbour = texelFetch(scene_color, texel, 0).rgb;
+            low = min(low, neighbour);
+            high = max(high, neighbour);
+            depth = min(depth, texelFetch(scene_depth, texel, 0).r);
+        }
+    }
+
+    vec4 previous = reprojection * vec4(uv * 2. - 1., depth * 2. - 1., 1.);
+    vec2 previous_uv = previous.xy / previous.w * .5 + .5;
+
+    // what was off screen last frame has no history, and a fresh history target holds garbage that must not be read
+    vec3 result = current;
+    if (history_weight > 0. && previous.w > 0. && all(greaterThanEqual(previous_uv, vec2(0.))) && all(lessThanEqual(previous_uv, vec2(1.)))) {
+        vec2 history_position = clamp(previous_uv * output_size, vec2(.5), output_size - .5);
+        vec3 accumulated = texture(history, history_position / vec2(textureSize(history, 0))).rgb;
+        result = mix(current, clamp(accumulated, low, high), history_weight);
+    }
+    color = vec4(result, 1.);
+}
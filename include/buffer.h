@@ -1,4 +1,6 @@
 #pragma once
+#include <vector>
+#include <cstddef>
 #include "glad/glad.h"
 #include "texture.h"
 
@@ -14,7 +16,7 @@ namespace Engine {
         public:
             Buffer();
             ~Buffer();
-            void data(void* data, size_t data_size);
+            void data(const void* data, size_t data_size);
     };
 
     class VAO : public GL_Object {
@@ -23,6 +25,8 @@ namespace Engine {
             ~VAO();
             void bind();
             void bind_buffers(GLuint vbo_id, GLuint ebo_id);
+            // for attribute-less draws that pull their vertices from gl_VertexID
+            void bind_index_buffer(GLuint ebo_id);
             void attrib(GLuint index, GLint size, GLenum type, GLboolean normalized, GLuint offset);
     };
 
@@ -52,4 +56,48 @@ namespace Engine {
         SSBO();
         void data(unsigned int index, unsigned int *data, size_t data_size);
     };
+
+    // fixed-size std140 block, written with glNamedBufferSubData and bound to an indexed uniform binding
+    class UBO : public GL_Object {
+    public:
+        UBO(size_t size);
+        ~UBO();
+        void data(const void* data, size_t data_size, size_t offset = 0);
+        void bind(GLuint index);
+    };
+
+    // persistently mapped ring of `frames` regions; a region is only rewritten after the gpu has signalled the fence placed behind its last use
+    class StreamBuffer : public GL_Object {
+    public:
+        struct Allocation {
+            void* data;
+            GLintptr offset;
+            size_t size;
+        };
+
+        StreamBuffer(size_t frame_size, size_t frames = 3);
+        ~StreamBuffer();
+        StreamBuffer(const StreamBuffer&) = delete;
+        StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+        // moves to the next region, waiting only if the gpu is still reading it; a no-op while a frame is open
+        void begin_frame();
+        // returns nullptr data when the current region is exhausted
+        Allocation allocate(size_t size, size_t alignment = 256);
+        // fences every command issued so far against the current region
+        void end_frame();
+
+        size_t get_frame_size() { return frame_size; }
+        float get_wait_ms() { return wait_ms; }
+
+    private:
+        std::byte* mapping {nullptr};
+        size_t frame_size;
+        size_t frames;
+        size_t frame {0};
+        size_t head {0};
+        bool open {false};
+        std::vector<GLsync> fences;
+        float wait_ms {0.f};
+    };
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "buffer.h"
+#include "shader.h"
+#include "ocean.h"
+
+namespace Engine::Game {
+    struct BuoyancySettings {
+        size_t count {1024};
+        float spacing {4.f};
+        float min_scale {.6f};
+        float max_scale {1.6f};
+        // kg/m^3, so anything below the water's 1025 floats
+        float density {500.f};
+        // 1/s at full submersion, applied per hull voxel
+        float linear_drag {1.5f};
+        float angular_drag {1.f};
+        uint32_t seed {7};
+    };
+
+    // floating cubes in structure-of-arrays form. every body is a voxel hull of HULL_POINTS cells; each step transforms all
+    // hull points, answers them with one batched ocean query and integrates the bodies in parallel
+    class Buoyancy {
+    public:
+        // 2x2x2 voxels of an axis aligned unit cube, sampled at the voxel centres
+        static constexpr size_t HULL_POINTS {8};
+        static constexpr GLuint INSTANCE_BINDING {0};
+
+        // std430 mirror of shaders/buoyancy/vert.glsl
+        struct Instance {
+            glm::vec4 position_scale;
+            glm::vec4 orientation;  // x, y, z, w
+        };
+
+        Buoyancy(const BuoyancySettings& settings);
+        // respawns every body
+        void rebuild(const BuoyancySettings& settings);
+        // advances one fixed step, with the surface as rendered at `time`
+        void step(Ocean& ocean, double time, float dt);
+        // draws the bodies `alpha` of the way from the previous to the newest step, like the ocean states
+        void draw(Shader& shader, float alpha);
+
+        const BuoyancySettings& get_settings() { return settings; }
+        size_t get_count() { return settings.count; }
+        float get_step_ms() { return step_ms; }
+
+    private:
+        BuoyancySettings settings;
+
+        std::vector<float> position_x, position_y, position_z;
+        std::vector<float> velocity_x, velocity_y, velocity_z;
+        std::vector<float> orientation_w, orientation_x, orientation_y, orientation_z;
+        std::vector<float> angular_velocity_x, angular_velocity_y, angular_velocity_z;
+        std::vector<float> scale;
+        std::vector<float> mass;
+
+        // the state before the last step, for interpolated drawing
+        std::vector<float> previous_position_x, previous_position_y, previous_position_z;
+        std::vector<float> previous_orientation_w, previous_orientation_x, previous_orientation_y, previous_orientation_z;
+
+        // count * HULL_POINTS hull points per step: the world space offsets from the centre of mass and the query batch
+        std::vector<float> offset_x, offset_y, offset_z;
+        std::vector<float> point_x, point_z;
+        std::vector<float> height, displacement_x, displacement_z, normal_x, normal_y, normal_z;
+
+        std::unique_ptr<VAO> vao;
+        std::unique_ptr<StreamBuffer> stream;
+
+        float step_ms {0.f};
+    };
+}
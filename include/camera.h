@@ -27,6 +27,7 @@ namespace Engine {
             float fov {60.f};
             float z_near {.1f};
             float z_far {100.f};
+            double orbit_time {0.};
             glm::mat4 projection;
 
 
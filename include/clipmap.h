@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string_view>
+#include "buffer.h"
+#include "shader.h"
+#include "grid_mesh.h"
+
+namespace Engine::Game {
+    static std::string_view grid_layout_to_string_view(GridMeshBuilder::Layout layout) {
+        switch (layout) {
+            case GridMeshBuilder::Layout::RowMajor: return "row-major";
+            case GridMeshBuilder::Layout::VertexCache: return "vertex-cache";
+            case GridMeshBuilder::Layout::Strips: return "strips";
+            default: return "undefined";
+        };
+    }
+
+    struct ClipmapSettings {
+        // the normals are shaded per fragment, so the cells only have to resolve the displacement. with the default
+        // cascades the finest band starts at about 2.8 m waves, which half metre cells still give five vertices; coarser
+        // levels fade it out of the geometry (see ocean/vert.glsl)
+        size_t grid_size {64};
+        size_t levels {9};
+        float cell_size {.5f};
+        GridMeshBuilder::Layout layout {GridMeshBuilder::Layout::VertexCache};
+    };
+
+    // nested square rings of one shared (grid_size + 1)^2 vertex grid, every ring twice as coarse as the one inside.
+    // the grid only exists as index buffers, the vertex shader places each vertex from gl_VertexID and the level's uniforms
+    class Clipmap {
+    public:
+        struct Level {
+            glm::vec2 origin;
+            float cell_size;
+            size_t variant;
+        };
+
+        Clipmap(const ClipmapSettings& settings);
+        void rebuild(const ClipmapSettings& settings);
+        void update(glm::vec3 camera_position);
+        void draw(Shader& shader);
+
+        const ClipmapSettings& get_settings() { return settings; }
+        const std::vector<Level>& get_levels() { return levels; }
+        size_t get_level_vertex_count(size_t level);
+        size_t get_level_triangle_count(size_t level);
+        const GridMeshBuilder::Report& get_level_report(size_t level);
+        size_t get_index_bytes();
+
+    private:
+        static constexpr size_t VARIANT_FULL {4};
+
+        ClipmapSettings settings;
+        std::vector<Level> levels;
+        glm::vec3 camera_position {0.f};
+
+        std::unique_ptr<GridMeshBuilder> grid;
+        GridMeshBuilder::Range ranges[VARIANT_FULL + 1] {};
+        GridMeshBuilder::Report reports[VARIANT_FULL + 1] {};
+
+        std::unique_ptr<VAO> vao;
+        std::unique_ptr<Buffer> ebo;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine::Time {
+    // fixed-step simulation clock: wall time accumulates and is consumed in whole steps, at most `max_steps` per frame.
+    // state times are exact multiples of the timestep, so runs with the same deltas are reproducible
+    class SimulationClock {
+    public:
+        SimulationClock(double timestep = 1. / 60., size_t max_steps = 4);
+
+        // returns how many steps became due; anything beyond the catch-up cap is dropped instead of owed
+        size_t advance(double delta_time);
+        void reset();
+        // keeps the current time and restarts the step count from it
+        void set_timestep(double timestep);
+        void set_max_steps(size_t max_steps) { this->max_steps = max_steps; }
+
+        double get_timestep() const { return timestep; }
+        size_t get_max_steps() const { return max_steps; }
+        uint64_t get_step() const { return step; }
+        // time of the newest state
+        double get_time() const { return origin + static_cast<double>(step) * timestep; }
+        // fraction of a step accumulated past the newest state
+        float get_alpha() const { return static_cast<float>(accumulator / timestep); }
+        // the displayed time, blended between the last two states and so one step behind get_time()
+        double get_render_time() const { return get_time() - timestep + accumulator; }
+        double get_dropped_time() const { return dropped_time; }
+
+    private:
+        double timestep;
+        size_t max_steps;
+        double origin {0.};
+        uint64_t step {0};
+        double accumulator {0.};
+        double dropped_time {0.};
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <complex>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace Engine::FFT {
+    enum class Direction {
+        Forward,
+        Inverse
+    };
+
+    // mixed-radix (4, 2, 3, generic) stockham transform, both directions are unnormalised
+    template <typename T>
+    class Plan {
+        public:
+            explicit Plan(size_t size);
+            void execute(std::complex<T>* data, std::complex<T>* scratch, Direction direction) const;
+            void execute(std::complex<T>* data, Direction direction) const;
+
+            size_t get_size() const { return size; }
+            const std::vector<size_t>& get_factors() const { return factors; }
+
+        private:
+            size_t size;
+            std::vector<size_t> factors;
+            std::vector<std::complex<T>> twiddles;
+    };
+
+    // real input of `size` samples <-> `size / 2 + 1` hermitian bins, computed through a half sized complex plan
+    template <typename T>
+    class RealPlan {
+        public:
+            explicit RealPlan(size_t size);
+            void forward(const T* input, std::complex<T>* output) const;
+            void inverse(const std::complex<T>* input, T* output) const;
+
+            size_t get_size() const { return size; }
+            size_t get_bins() const { return size / 2 + 1; }
+
+        private:
+            size_t size;
+            std::shared_ptr<const Plan<T>> complex_plan;
+            std::vector<std::complex<T>> twiddles;
+    };
+
+    template <typename T>
+    std::shared_ptr<const Plan<T>> get_plan(size_t size);
+
+    template <typename T>
+    std::shared_ptr<const RealPlan<T>> get_real_plan(size_t size);
+
+    extern template class Plan<float>;
+    extern template class Plan<double>;
+    extern template class RealPlan<float>;
+    extern template class RealPlan<double>;
+}
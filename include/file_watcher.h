@@ -0,0 +1,44 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+namespace Engine {
+    // watches individual files from a background thread (inotify on linux, timestamp polling elsewhere)
+    class FileWatcher {
+    public:
+        FileWatcher();
+        ~FileWatcher();
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        void watch(const std::filesystem::path& file);
+
+        // files whose last change is older than the debounce interval, each reported once
+        std::vector<std::filesystem::path> poll_changes();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        void run();
+        void record_change(const std::filesystem::path& file);
+
+        std::mutex mutex;
+        std::set<std::filesystem::path> files;
+        std::map<std::filesystem::path, Clock::time_point> changes;
+        std::atomic<bool> running {true};
+        std::thread thread;
+
+#ifdef __linux__
+        int descriptor {-1};
+        std::map<int, std::filesystem::path> directories;
+#else
+        std::map<std::filesystem::path, std::filesystem::file_time_type> timestamps;
+#endif
+    };
+}
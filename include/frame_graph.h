@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <initializer_list>
+#include <cstdint>
+#include <glad/glad.h>
+#include "buffer.h"
+#include "texture.h"
+#include "render_target.h"
+
+namespace Engine {
+    // passes are declared every frame with the resources they touch; unused passes are culled,
+    // transient targets live only from their first to their last use, and barriers follow the declared accesses
+    class FrameGraph {
+    public:
+        using Resource = size_t;
+        static constexpr Resource NONE {SIZE_MAX};
+
+        enum class Usage {
+            Sampled,    // texture()/texelFetch()
+            Image,      // imageLoad()/imageStore()
+            Attachment, // framebuffer color or depth
+            Storage,    // shader storage buffer
+            Transfer    // glTextureSubImage and other copies, ordered by gl itself
+        };
+
+        class Builder {
+        public:
+            Resource create(std::string_view name, const RenderTargetPool::Description& description);
+            Resource read(Resource resource, Usage usage);
+            Resource write(Resource resource, Usage usage);
+
+        private:
+            friend class FrameGraph;
+            Builder(FrameGraph& graph, size_t pass) : graph(graph), pass(pass) {}
+
+            FrameGraph& graph;
+            size_t pass;
+        };
+
+        class Context {
+        public:
+            Texture* get_texture(Resource resource);
+            glm::uvec2 get_size(Resource resource);
+            // binds a cached framebuffer for these attachments and sets the viewport to their (unbucketed) size
+            void bind_framebuffer(std::initializer_list<Resource> colors, Resource depth = NONE);
+
+        private:
+            friend class FrameGraph;
+            Context(FrameGraph& graph) : graph(graph) {}
+
+            FrameGraph& graph;
+        };
+
+        FrameGraph(RenderTargetPool& pool);
+
+        Resource import_texture(std::string_view name, Texture* texture, glm::uvec2 size);
+        // outputs keep the passes that produce them alive, everything else is culled when nobody reads it
+        void set_output(Resource resource);
+        void add_pass(std::string_view name, const std::function<void(Builder&)>& setup, std::function<void(Context&)> execute);
+
+        // compiles, runs and clears the passes added this frame
+        void execute();
+        void draw_imgui();
+
+    private:
+        struct ResourceNode {
+            std::string name;
+            Texture* texture {nullptr};
+            RenderTargetPool::Description description {};
+            bool imported {false};
+            bool output {false};
+            std::vector<size_t> writers;
+            size_t readers {0};
+            size_t first_pass {NONE};
+            size_t last_pass {NONE};
+        };
+
+        struct Access {
+            Resource resource;
+            Usage usage;
+            bool write;
+        };
+
+        struct PassNode {
+            std::string name;
+            std::function<void(Context&)> execute;
+            std::vector<Access> accesses;
+            size_t references {0};
+            bool culled {false};
+            GLbitfield barriers {0};
+        };
+
+        struct PassReport {
+            std::string name;
+            bool culled;
+            GLbitfield barriers;
+            size_t transient_bytes;
+            size_t reads;
+            size_t writes;
+        };
+
+        struct CachedFramebuffer {
+            std::unique_ptr<FBO> framebuffer;
+            size_t last_frame;
+        };
+
+        void cull();
+        void compute_barriers();
+
+        RenderTargetPool& pool;
+        std::vector<ResourceNode> resources;
+        std::vector<PassNode> passes;
+        std::map<std::vector<GLuint>, CachedFramebuffer> framebuffers;
+        // imported textures whose last incoherent write has not reached every kind of consumer yet, with the barriers
+        // already issued since
+        std::map<const Texture*, GLbitfield> imported_writes;
+        size_t frame {0};
+
+        std::vector<PassReport> reports;
+        size_t requested_bytes {0};
+        size_t resident_bytes {0};
+        size_t barrier_count {0};
+    };
+}
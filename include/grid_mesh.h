@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+
+namespace Engine {
+    // index buffers over one (cells + 1)^2 vertex lattice, in 16-bit indices whenever the lattice fits.
+    // an index is the lattice position z * (cells + 1) + x, so shaders rebuild the vertex from gl_VertexID and need no vertex buffer
+    class GridMeshBuilder {
+    public:
+        enum class Layout {
+            RowMajor,       // triangles cell by cell across the whole width
+            VertexCache,    // triangles in column bands narrow enough that the previous row is still cached
+            Strips          // one strip per band row, separated by primitive restart
+        };
+
+        struct Range {
+            size_t offset;  // in indices
+            size_t count;
+        };
+
+        struct Report {
+            size_t triangles {0};
+            size_t vertices {0};
+            size_t indices {0};
+            size_t index_bytes {0};
+            // vertex shader invocations per triangle and per referenced vertex, from a CACHE_SIZE fifo
+            float acmr {0.f};
+            float atvr {0.f};
+        };
+
+        // post-transform cache the orders are tuned for and the report simulates; small enough for any current gpu
+        static constexpr size_t CACHE_SIZE {32};
+        static constexpr size_t BAND_WIDTH {CACHE_SIZE / 2 - 1};
+
+        GridMeshBuilder(size_t cells, Layout layout);
+
+        // appends the indices for every cell outside the half-open rectangle [hole_min, hole_max)
+        Range add(size_t hole_min_x = 0, size_t hole_min_z = 0, size_t hole_max_x = 0, size_t hole_max_z = 0);
+        Report report(const Range& range) const;
+
+        GLenum get_mode() const { return layout == Layout::Strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES; }
+        GLenum get_index_type() const { return wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT; }
+        size_t get_index_size() const { return wide ? sizeof(uint32_t) : sizeof(uint16_t); }
+        const void* get_index_data() const { return wide ? static_cast<const void*>(indices32.data()) : static_cast<const void*>(indices16.data()); }
+        size_t get_index_count() const { return wide ? indices32.size() : indices16.size(); }
+        size_t get_index_bytes() const { return get_index_count() * get_index_size(); }
+        size_t get_vertex_count() const { return (cells + 1) * (cells + 1); }
+        size_t get_cells() const { return cells; }
+        Layout get_layout() const { return layout; }
+
+    private:
+        template <typename T>
+        Range emit(std::vector<T>& indices, size_t hole_min_x, size_t hole_min_z, size_t hole_max_x, size_t hole_max_z);
+
+        size_t cells;
+        Layout layout;
+        bool wide;
+        std::vector<uint16_t> indices16;
+        std::vector<uint32_t> indices32;
+    };
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <span>
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include "renderer.h"
+
+namespace Engine {
+    struct BenchmarkSettings {
+        size_t frames {600};
+        size_t warmup_frames {30};
+        double timestep {1. / 60.};
+        int width {1280};
+        int height {720};
+        size_t grid_size {128};
+        size_t spectrum_size {256};
+        size_t bodies {1024};
+        // plays this bake instead of running the fft
+        std::string baked_file;
+        // when set, writes a bake of `bake_frames` frames over `bake_period` seconds instead of benchmarking
+        std::string bake_file;
+        size_t bake_frames {256};
+        float bake_period {32.f};
+        bool cpu_only {false};
+        std::string output_file {"benchmark.json"};
+
+        static BenchmarkSettings from_arguments(std::span<char*> arguments);
+    };
+
+    // runs the simulation (and, when a surfaceless context is available, the scene) at a fixed timestep without a window or imgui
+    class Headless {
+    public:
+        Headless(const BenchmarkSettings& settings);
+        ~Headless();
+        int run();
+        int bake();
+
+    private:
+        struct Stage {
+            std::string name;
+            std::vector<double> samples;
+        };
+
+        bool create_context();
+        void write_results(const std::vector<Stage>& stages);
+
+        BenchmarkSettings settings;
+        GLFWwindow* window {nullptr};
+        std::string context_description {"cpu-only"};
+        double shader_startup_ms {0.};
+    };
+}
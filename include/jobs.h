@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <initializer_list>
+
+namespace Engine {
+    // work-stealing scheduler: every worker owns a deque it pops from the back, idle workers steal from the front of others
+    class Jobs {
+    public:
+        struct Task;
+        using Handle = std::shared_ptr<Task>;
+
+        static size_t get_worker_count();
+
+        // splits [0, count) into chunks of at least `grain` items and runs them on the workers and the calling thread
+        static void parallel_for(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+        // queues `body` once every dependency has finished; null handles count as finished
+        static Handle submit(std::function<void()> body, std::initializer_list<Handle> dependencies = {});
+        static bool is_done(const Handle& handle);
+        // runs `handle` and the parallel_for chunks it queued on the calling thread if they are still waiting, then sleeps
+        // until it has finished. other queued jobs are left to the workers
+        static void wait(const Handle& handle);
+    };
+}
@@ -0,0 +1,240 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <complex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+#include "texture.h"
+#include "buffer.h"
+#include "transform.h"
+#include "jobs.h"
+#include "wave_query.h"
+
+namespace Engine::Game {
+    enum class OceanSpectrum {
+        Phillips,
+        Jonswap
+    };
+
+    static std::string_view ocean_spectrum_to_string_view(OceanSpectrum spectrum) {
+        switch(spectrum) {
+            case OceanSpectrum::Phillips: return "spectrum_phillips";
+            case OceanSpectrum::Jonswap: return "spectrum_jonswap";
+            default: return "spectrum_undefined";
+        };
+    }
+
+    struct OceanSettings {
+        static constexpr size_t MAX_CASCADES {4};
+        // longest update period, in simulation steps
+        static constexpr uint32_t MAX_UPDATE_PERIOD {8};
+
+        OceanSpectrum spectrum {OceanSpectrum::Jonswap};
+        size_t resolution {256};
+        // tile of the first cascade, every further one is cascade_scale times smaller. each cascade carries its own band of
+        // wavenumbers, so the long swell tiles over hundreds of metres while the short chop still gets its detail
+        float patch_size {256.f};
+        size_t cascade_count {3};
+        float cascade_scale {4.f};
+        // simulation steps between two updates of each cascade, rounded down to a power of two. the swell barely moves
+        // between steps, so it can be stepped less often than the chop
+        std::array<uint32_t, MAX_CASCADES> update_periods {2, 2, 1, 1};
+        float wind_speed {10.f};
+        float wind_direction {0.f};
+        float fetch {10000.f};
+        float amplitude {1.f};
+        float choppiness {1.f};
+        uint32_t seed {1337};
+        // metres of water; finite depth slows the longer waves down
+        float depth {500.f};
+        // exponent s of the cos^2s directional spreading, higher keeps the waves closer to the wind direction
+        float spread {1.f};
+        // > 0 rounds every frequency down to a multiple of 2 pi / loop_period, so the surface repeats after that many seconds
+        float loop_period {0.f};
+
+        bool operator==(const OceanSettings&) const = default;
+
+        float get_patch_size(size_t cascade) const;
+        // the bands split at these wavenumbers: cascade i keeps get_band_start(i) <= |k| < get_band_start(i + 1)
+        float get_band_start(size_t cascade) const;
+    };
+
+    class OceanBake;
+
+    // tessendorf fft ocean, evolved and transformed on the cpu and uploaded as repeating textures
+    class Ocean {
+    public:
+        // what the spectrum is derived into; an edit only rebuilds the stages that read a changed setting, and what reads them:
+        //   grid        resolution, patch size, cascades                k_x, k_z
+        //   noise       resolution, seed, cascade count                 gaussian pairs
+        //   dispersion  grid, depth, loop period                        omega
+        //   amplitudes  grid, noise, spectrum, wind, fetch, spread      h0, h0_minus_conj
+        // choppiness and the update periods are only read by the step, so changing them rebuilds nothing. every stage holds
+        // all cascades, one resolution^2 block after the other
+        enum SpectrumStage : uint32_t {
+            STAGE_GRID = 1u << 0,
+            STAGE_NOISE = 1u << 1,
+            STAGE_DISPERSION = 1u << 2,
+            STAGE_AMPLITUDES = 1u << 3
+        };
+
+        static uint32_t get_invalidated_stages(const OceanSettings& from, const OceanSettings& to);
+
+        Ocean(const OceanSettings& settings);
+        ~Ocean();
+        // builds the new spectrum before returning; also leaves baked playback
+        void rebuild(const OceanSettings& settings);
+        // builds on the workers while the current spectrum keeps evolving, and edits made meanwhile are coalesced into one more
+        // build. update() switches over between frames
+        void request_rebuild(const OceanSettings& settings);
+        void update();
+        // replaces the fft with frames streamed from a bake written by OceanBake::write; on failure the simulation keeps running
+        bool load_bake(const std::filesystem::path& path);
+        const OceanBake* get_bake() { return bake.get(); }
+        void simulate(double time, bool every_cascade = false);
+        // starts the step for `time` on the workers; it is handed over by the next finish_simulation() or upload().
+        // only the cascades the schedule has due are stepped, unless `every_cascade` is set, and a cascade stepped every
+        // n steps is simulated n - 1 steps ahead, so the render time stays between its two states until it is next due
+        void begin_simulation(double time, bool every_cascade = false);
+        void finish_simulation();
+        // waits for the step in flight first, so the usual frame is upload() followed by begin_simulation() for the next one.
+        // every cascade stepped since the last upload flips its layers, the one it replaces becomes its previous state
+        void upload();
+        // textures are created lazily so the simulation also runs without a gl context; does nothing once they exist
+        void create_textures();
+
+        // what is being simulated and rendered, which trails get_requested_settings() while a rebuild is running
+        const OceanSettings& get_settings() { return settings; }
+        const OceanSettings& get_requested_settings() { return requested_settings; }
+        bool is_rebuilding() { return rebuild_job != nullptr; }
+        // stages the active spectrum rebuilt from its predecessor, and how long that took
+        uint32_t get_rebuilt_stages();
+        float get_rebuild_ms();
+        // array textures with two layers per cascade, 2i and 2i + 1, which take turns holding its current state
+        Texture* get_displacement_texture() { return displacement_texture.get(); }
+        // mipmapped for the per fragment normals, every upload that brings a state rebuilds the chain
+        Texture* get_slope_texture() { return slope_texture.get(); }
+        // whitecap coverage in the same layers, accumulated on the gpu once per uploaded state: the foam pass reads a
+        // cascade's previous layer and writes its current one, so coverage stays paired with the state it was found in
+        Texture* get_foam_texture() { return foam_texture.get(); }
+        size_t get_cascade_count() { return cascades.size(); }
+        uint32_t get_current_layer(size_t cascade) { return static_cast<uint32_t>(cascade * 2) + cascades[cascade].layer; }
+        uint32_t get_previous_layer(size_t cascade) { return get_current_layer(cascade) ^ 1u; }
+        // bit i is set when the last upload brought a new state of cascade i
+        uint32_t get_uploaded_cascades() { return uploaded_cascades; }
+        // simulation time covered by the cascade's last upload, for the foam decay
+        double get_upload_interval(size_t cascade) { return cascades[cascade].upload_interval; }
+        // blend factor from the cascade's previous towards its current layer that displays `time`
+        float get_interpolation(double time, size_t cascade);
+        // height, normal and displacement of the full surface at `time`, from the cpu copies of both states. the rendered
+        // geometry only agrees near the camera, where it keeps every cascade (see WaveQuery)
+        void query(const WaveQuery::Batch& batch, double time, size_t iterations = 2);
+        WaveQuery::Field get_query_field(bool previous, size_t cascade);
+
+        // the schedule repeats every get_schedule_load().size() steps and runs get_schedule_load()[step] cascade
+        // transforms in each of them; the phases spread the cascades so the most any step runs, the budget, is as low as
+        // the periods allow, and the same in every step whenever the update rates add up to a whole number
+        uint32_t get_update_period(size_t cascade) { return cascades[cascade].period; }
+        uint32_t get_update_phase(size_t cascade) { return cascades[cascade].phase; }
+        const std::vector<uint32_t>& get_schedule_load() { return schedule_load; }
+        uint32_t get_fft_budget() { return fft_budget; }
+        // bit i is set when the newest step ran cascade i
+        uint32_t get_stepped_cascades() { return stepped_cascades; }
+        float get_simulation_ms() { return simulation_ms; }
+        float get_upload_ms() { return upload_ms; }
+
+    private:
+        struct Spectrum;
+
+        // shares every stage of `base` that `stages` leaves valid
+        static std::shared_ptr<const Spectrum> build_spectrum(const std::shared_ptr<const Spectrum>& base, const OceanSettings& settings, uint32_t stages);
+        void start_rebuild();
+        // switches to `next`; only a new resolution (or leaving playback) waits for the step in flight
+        void adopt_spectrum(std::shared_ptr<const Spectrum> next);
+        struct StepTarget {
+            size_t cascade;
+            float time;
+            glm::vec4* mapped_displacement;
+            glm::vec2* mapped_slope;
+        };
+
+        // one band of the spectrum on its own tile. its cpu states rotate only when it is stepped, staging -> current ->
+        // previous, and its layers flip only when such a state is uploaded
+        struct Cascade {
+            std::vector<glm::vec4> displacement_data;
+            std::vector<glm::vec2> slope_data;
+            std::vector<glm::vec4> current_displacement_data;
+            std::vector<glm::vec2> current_slope_data;
+            std::vector<glm::vec4> previous_displacement_data;
+            std::vector<glm::vec2> previous_slope_data;
+            StreamBuffer::Allocation displacement_allocation {};
+            StreamBuffer::Allocation slope_allocation {};
+            size_t states {0};
+            size_t uploads {0};
+            // stepped by the job in flight, and stepped since the last upload
+            bool scheduled {false};
+            bool dirty {false};
+            double pending_time {0.};
+            double current_time {0.};
+            double previous_time {0.};
+            double uploaded_time {0.};
+            double upload_interval {0.};
+            // which of the cascade's two layers is current
+            uint32_t layer {0};
+            // stepped on the steps where step % period == phase
+            uint32_t period {1};
+            uint32_t phase {0};
+        };
+
+        // steps every target and packs it into its cascade's staging vectors and, when given, into the mapped stream buffer
+        void step(const Spectrum& spectrum, float choppiness, const std::vector<StepTarget>& targets);
+        // places every cascade's period at the phase that keeps the per step load flattest
+        void schedule_cascades();
+        // drops the textures and the stream so the next upload recreates them for the current resolution and source
+        void reset_textures();
+        // sizes every cascade's states for the current settings and forgets them
+        void reset_cascades();
+
+        OceanSettings settings;
+        OceanSettings requested_settings;
+
+        // immutable once built, so a step keeps the one it started with while the next is adopted
+        std::shared_ptr<const Spectrum> spectrum;
+        std::shared_ptr<const Spectrum> rebuilt;
+        Jobs::Handle rebuild_job;
+
+        // room for every cascade's three packed fields, the step transforms the ones it runs side by side
+        std::vector<std::complex<float>> displacement_field;
+        std::vector<std::complex<float>> slope_field;
+        std::vector<std::complex<float>> height_field;
+
+        // the step writes the staging pairs; finish_simulation() rotates them into current and current into previous,
+        // so these always match the layers and serve cpu queries while the next step runs
+        std::vector<Cascade> cascades;
+        Jobs::Handle simulation_job;
+        uint64_t schedule_step {0};
+        double requested_time {0.};
+        uint32_t stepped_cascades {0};
+        uint32_t uploaded_cascades {0};
+        std::vector<uint32_t> schedule_load;
+        uint32_t fft_budget {0};
+
+        std::unique_ptr<Texture> displacement_texture;
+        std::unique_ptr<Texture> slope_texture;
+        std::unique_ptr<Texture> foam_texture;
+        std::unique_ptr<StreamBuffer> stream;
+
+        // while set, a step decodes the baked frame at or after its time for every cascade instead of running the fft,
+        // and upload() copies the frame straight from the file mapping
+        std::unique_ptr<OceanBake> bake;
+        size_t pending_frame {0};
+        size_t current_frame {0};
+
+        // written by the step on a worker while the ui reads it
+        std::atomic<float> simulation_ms {0.f};
+        float upload_ms {0.f};
+    };
+}
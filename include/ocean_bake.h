@@ -0,0 +1,72 @@
+#pragma once
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include "ocean.h"
+
+namespace Engine::Game {
+    // one period of a looping ocean, for playback without the fft. the file is a header followed by `frame_count` chunks
+    // aligned to CHUNK_ALIGNMENT, each one state of every cascade in order as half floats: a cascade's rgba displacement
+    // texels, then its rg slope texels. chunks are read straight out of a read-only file mapping, native (little) endian
+    class OceanBake {
+    public:
+        static constexpr char MAGIC[8] {'O', 'C', 'N', 'B', 'A', 'K', 'E', '1'};
+        static constexpr uint32_t VERSION {2};
+        // page sized, so every chunk starts on its own pages
+        static constexpr size_t CHUNK_ALIGNMENT {4096};
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t resolution;
+            uint32_t frame_count;
+            uint32_t cascade_count;
+            float patch_size;
+            float cascade_scale;
+            float period;
+            uint32_t reserved;
+            uint64_t chunk_offset;
+            uint64_t chunk_stride;
+        };
+        static_assert(sizeof(Header) == 56, "the bake header is written as is");
+
+        // simulates every cascade of `settings` at `frames` evenly spaced times over settings.loop_period, which has to be set
+        static bool write(const std::filesystem::path& path, const OceanSettings& settings, size_t frames);
+        static std::unique_ptr<OceanBake> open(const std::filesystem::path& path);
+
+        ~OceanBake();
+        OceanBake(const OceanBake&) = delete;
+        OceanBake& operator=(const OceanBake&) = delete;
+
+        // frames wrap around, so any index is valid
+        const uint16_t* get_displacement(size_t frame, size_t cascade) const;
+        const uint16_t* get_slope(size_t frame, size_t cascade) const;
+        // expands one cascade of a frame to the layout of the live simulation's cpu copies
+        void decode(size_t frame, size_t cascade, glm::vec4* displacement, glm::vec2* slope) const;
+
+        size_t get_resolution() const { return header.resolution; }
+        size_t get_frame_count() const { return header.frame_count; }
+        size_t get_cascade_count() const { return header.cascade_count; }
+        float get_patch_size() const { return header.patch_size; }
+        float get_cascade_scale() const { return header.cascade_scale; }
+        float get_period() const { return header.period; }
+        double get_frame_interval() const { return static_cast<double>(header.period) / header.frame_count; }
+        size_t get_file_bytes() const { return mapping_size; }
+        const std::filesystem::path& get_path() const { return path; }
+
+    private:
+        OceanBake() = default;
+
+        std::filesystem::path path;
+        Header header {};
+        const std::byte* mapping {nullptr};
+        size_t mapping_size {0};
+#if defined(_WIN32)
+        void* file {nullptr};
+        void* file_mapping {nullptr};
+#else
+        int file {-1};
+#endif
+    };
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+
+namespace Engine::Philox {
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    // philox 4x32-10 (salmon et al. 2011): ten rounds of a keyed bijection over a 128 bit counter. there is no state,
+    // every output is a pure function of (counter, key), so values can be drawn in any order on any thread and vectorise
+    // as plain 32 bit multiplies
+    constexpr Counter generate(Counter counter, Key key) {
+        constexpr uint32_t MULTIPLIER_0 {0xd2511f53u};
+        constexpr uint32_t MULTIPLIER_1 {0xcd9e8d57u};
+        constexpr uint32_t WEYL_0 {0x9e3779b9u};
+        constexpr uint32_t WEYL_1 {0xbb67ae85u};
+
+        for (int round {0}; round < 10; round++) {
+            const uint64_t product_0 {static_cast<uint64_t>(MULTIPLIER_0) * counter[0]};
+            const uint64_t product_1 {static_cast<uint64_t>(MULTIPLIER_1) * counter[2]};
+            counter = {
+                static_cast<uint32_t>(product_1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<uint32_t>(product_1),
+                static_cast<uint32_t>(product_0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<uint32_t>(product_0)
+            };
+            key[0] += WEYL_0;
+            key[1] += WEYL_1;
+        }
+        return counter;
+    }
+
+    // top 24 bits onto (0, 1], so the logarithm below never sees zero
+    constexpr float to_unit(uint32_t bits) {
+        return static_cast<float>((bits >> 8) + 1u) * 0x1p-24f;
+    }
+
+    // two independent standard normals from the first two words, through box-muller
+    inline std::complex<float> gaussian_pair(const Counter& counter, const Key& key) {
+        const Counter bits {generate(counter, key)};
+        const float radius {std::sqrt(-2.f * std::log(to_unit(bits[0])))};
+        const float angle {2.f * std::numbers::pi_v<float> * to_unit(bits[1])};
+        return {radius * std::cos(angle), radius * std::sin(angle)};
+    }
+}
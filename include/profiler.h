@@ -0,0 +1,45 @@
+#pragma once
+#include <string_view>
+#include <filesystem>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine {
+    class Profiler {
+    public:
+        static constexpr size_t HISTORY_SIZE {240};
+        static constexpr size_t QUERY_FRAMES {4};
+
+        struct Statistics {
+            float min {0.f};
+            float average {0.f};
+            float p99 {0.f};
+            // the newest sample, gpu ones trail the frame by up to QUERY_FRAMES
+            float last {0.f};
+        };
+
+        // times the enclosing block on the cpu and, when `gpu` is set and a context is active, with a pair of timestamp queries
+        class Scope {
+        public:
+            Scope(std::string_view name, bool gpu = true);
+            ~Scope();
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            size_t stage;
+            size_t query {SIZE_MAX};
+            std::chrono::steady_clock::time_point start;
+        };
+
+        static void set_gpu_enabled(bool enabled);
+        static void new_frame();
+
+        static Statistics get_cpu_statistics(std::string_view name);
+        static Statistics get_gpu_statistics(std::string_view name);
+
+        static void draw_imgui();
+        static bool export_chrome_trace(const std::filesystem::path& path);
+    };
+}
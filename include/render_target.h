@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <glad/glad.h>
+#include "texture.h"
+#include "transform.h"
+
+namespace Engine {
+    // hands out 2d render targets rounded up to size buckets, so a resize inside a bucket only changes the viewport
+    class RenderTargetPool {
+    public:
+        static constexpr unsigned int BUCKET_GRANULARITY {256};
+        // released targets nobody picked up again are freed after this many frames
+        static constexpr size_t RETIRE_FRAMES {120};
+
+        struct Description {
+            GLenum format;
+            glm::uvec2 size;
+            GLenum filter {GL_LINEAR};
+            GLenum wrap {GL_CLAMP_TO_EDGE};
+            // simulation sized targets are sampled with repeat and must keep their exact size
+            bool bucketed {true};
+        };
+
+        static glm::uvec2 bucket_size(glm::uvec2 size);
+        static size_t get_bytes(const Description& description);
+
+        // reuses a free target of the same format and bucket before allocating, `size` is the area that will be rendered to
+        Texture* acquire(const Description& description);
+        // returns a target to the pool, a later acquire in the same frame aliases its memory
+        void release(Texture* texture);
+        void new_frame();
+
+        size_t get_texture_count() { return entries.size(); }
+        size_t get_allocated_bytes();
+        size_t get_allocation_count() { return allocation_count; }
+
+    private:
+        struct Entry {
+            std::unique_ptr<Texture> texture;
+            Description description;
+            bool in_use;
+            size_t released_frame;
+        };
+
+        std::vector<Entry> entries;
+        size_t frame {0};
+        size_t allocation_count {0};
+    };
+}
@@ -10,20 +10,94 @@
 #include "camera.h"
 #include "utils.h"
 #include "mesh.h"
+#include "fft.h"
+#include "jobs.h"
+#include "ocean.h"
+#include "ocean_bake.h"
+#include "clipmap.h"
+#include "buoyancy.h"
+#include "profiler.h"
+#include "file_watcher.h"
+#include "render_target.h"
+#include "frame_graph.h"
+#include "clock.h"
 
 namespace Engine {
     namespace Game {
+        // std140 mirror of shaders/common/frame_data.glsl, written once per frame and shared by every program
+        struct FrameData {
+            glm::mat4 view;
+            glm::mat4 projection;
+            glm::vec3 camera_position;
+            float time;
+        };
+        static_assert(sizeof(FrameData) == 144, "FrameData must match the std140 layout of the glsl block");
+
+        struct FoamSettings {
+            bool enabled {true};
+            // jacobian below which new foam is injected, 1 would foam at any compression
+            float threshold {.8f};
+            // seconds for the coverage to decay to 1/e
+            float lifetime {2.f};
+        };
+
+        // the scene passes render at a fraction of the viewport that follows their measured gpu time, and a temporal pass
+        // resolves them back to the viewport; the ui always draws at the window's own resolution
+        struct RenderScaleSettings {
+            bool dynamic {true};
+            // gpu milliseconds the passes rendering at the scale (sky, ocean, bodies) should take together; the simulation,
+            // foam, temporal and post passes cost the same at any scale and are left out
+            float target_ms {8.f};
+            float min_scale {.5f};
+            float max_scale {1.f};
+            // used while dynamic is off
+            float scale {1.f};
+            // accumulates the jittered scene into a viewport sized history instead of stretching it bilinearly
+            bool temporal {true};
+            // share of the reprojected history in every resolved pixel
+            float history_weight {.9f};
+        };
+
         class Renderer {
         public:
             Renderer(float width, float height);
+            ~Renderer();
             void update(GLFWwindow* window, float delta_time);
             void render();
+            void render_scene();
             void refactor(int width, int height);
+
+            Ocean* get_ocean();
+            Clipmap* get_clipmap();
+            Buoyancy* get_buoyancy();
+            Time::SimulationClock& get_clock();
+            double get_shader_startup_ms();
         private:
             void draw_imgui();
+            void watch_shaders();
+            void update_shaders();
+            // picks this frame's scene size from the gpu time the scaled passes took in the frames before
+            void update_render_scale();
 
             std::unique_ptr<Camera> camera;
             std::map<std::string, Shader> shaders;
+            // rebuilds still compiling, swapped into `shaders` between frames once they link
+            std::map<std::string, Shader> pending_shaders;
+            std::map<std::filesystem::path, std::set<std::string>> shader_dependents;
+            std::unique_ptr<FileWatcher> shader_watcher;
+            Time::SimulationClock clock;
+            // steps the clock crossed this frame; any at all upload the next ocean state
+            size_t simulation_steps {0};
+            double shader_startup_ms {0.};
+            glm::uvec2 viewport_size {0};
+            FoamSettings foam_settings;
+            RenderScaleSettings render_scale_settings;
+            float render_scale {1.f};
+            float scaled_pass_ms {0.f};
+            glm::uvec2 scene_size {0};
+            // frames accumulated into the history, 0 drops it on the next resolve
+            size_t history_frames {0};
+            glm::mat4 previous_view_projection {1.f};
         };
     }
 }
\ No newline at end of file
@@ -1,31 +1,138 @@
 #pragma once
 #include <string_view>
+#include <string>
 #include <filesystem>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <span>
+#include <cstdint>
 #include <glad/glad.h>
 #include "transform.h"
+#include "buffer.h"
+#include "texture.h"
 #include "utils.h"
+#include "shader_preprocessor.h"
 
 namespace Engine {
+    enum class ShaderType {
+        Graphics,
+        Compute
+    };
+
+    // name lookups that accept a string_view without allocating a key
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+    };
+
+    template <typename T>
+    using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+    // what the linker kept, queried once per link so setters never go through glGetUniformLocation
+    struct ShaderReflection {
+        StringMap<GLint> uniforms;
+        StringMap<GLuint> uniform_blocks;
+        StringMap<GLuint> storage_blocks;
+    };
+
     class Shader {
+        public:
+            // every program that declares `FrameData` reads it from this binding, see Game::FrameData
+            static constexpr GLuint FRAME_BLOCK_BINDING {0};
+            static constexpr std::string_view FRAME_BLOCK_NAME {"FrameData"};
+
+            struct CacheStatistics {
+                size_t hits {0};
+                size_t misses {0};
+            };
+
         private:
-            unsigned int id;
+            unsigned int id {0};
+            ShaderType type {ShaderType::Graphics};
             std::string_view vert_file;
             std::string_view frag_file;
+            std::string_view comp_file;
+            glm::uvec3 workgroup_size {0};
+            GLbitfield written_barriers {0};
+            struct Stage {
+                GLenum type;
+                ShaderPreprocessor::Result source;
+            };
+
+            struct PendingStage {
+                unsigned int id;
+                std::vector<std::filesystem::path> files;
+            };
+
+            ShaderReflection reflection;
+            ShaderDefines defines;
+            std::vector<std::filesystem::path> dependencies;
+            std::vector<PendingStage> pending_stages;
+            uint64_t cache_key {0};
+            bool linked {false};
+
+            static GLbitfield pending_barriers;
+            static CacheStatistics cache_statistics;
+            static std::filesystem::path cache_directory;
 
         public:
             Shader() = default;
-            Shader(std::string_view vertex_shader_file, std::string_view fragment_shader_file);
+            Shader(std::string_view vertex_shader_file, std::string_view fragment_shader_file, const ShaderDefines& defines = {});
+            explicit Shader(std::string_view compute_shader_file, const ShaderDefines& defines = {});
+            Shader(const Shader&) = delete;
+            Shader& operator=(const Shader&) = delete;
+            Shader(Shader&& other) noexcept;
+            Shader& operator=(Shader&& other) noexcept;
             ~Shader();
             void use();
-            void reload();
+            // rebuilds from the current sources and only replaces this program if the new one links
+            bool reload();
+            // submits a fresh build of the same files without waiting for it, swap it in once is_ready()
+            Shader recompile() const;
+            bool is_linked();
+            // true once the driver has finished compiling and linking; never blocks when parallel compilation is available
+            bool is_ready();
+            // blocks until the program is linked, reports errors and stores the binary in the cache
+            void finish();
 
             Shader& set_uniform_float(std::string_view name, float value);
             Shader& set_uniform_mat4(std::string_view name, glm::mat4 matrix);
+            Shader& set_uniform_vec2(std::string_view name, glm::vec2 vector);
             Shader& set_uniform_vec3(std::string_view name, glm::vec3 vector);
+            Shader& set_uniform_int(std::string_view name, int value);
+            // fills a uniform array from its first element
+            Shader& set_uniform_floats(std::string_view name, std::span<const float> values);
+            Shader& set_uniform_ints(std::string_view name, std::span<const int> values);
+
+            // access is GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE; written resources are fenced before their next consumer.
+            // a write binding only marks the next dispatch as writing, so bind again before every dispatch that writes
+            Shader& bind_storage_buffer(GLuint binding, GL_Object& buffer, GLenum access);
+            // array textures are bound with every layer, for image2DArray
+            Shader& bind_image(GLuint unit, Texture& texture, GLenum access, GLenum format);
+            Shader& dispatch(GLuint groups_x, GLuint groups_y = 1, GLuint groups_z = 1);
+            Shader& dispatch_threads(GLuint threads_x, GLuint threads_y = 1, GLuint threads_z = 1);
+            Shader& dispatch_indirect(Buffer& buffer, GLintptr offset = 0);
+
+            ShaderType get_type() { return type; }
+            // every file the sources pulled in through #include, the stages themselves first
+            const std::vector<std::filesystem::path>& get_dependencies() { return dependencies; }
+            glm::uvec3 get_workgroup_size() { finish(); return workgroup_size; }
+            const ShaderReflection& get_reflection() { finish(); return reflection; }
+            GLint get_uniform_location(std::string_view name);
 
             static void unuse();
+            static void memory_barrier(GLbitfield consumers = GL_ALL_BARRIER_BITS);
+            // hands the tracked writes to a caller that issues its own, narrower barriers (see FrameGraph)
+            static GLbitfield take_pending_barriers() { return std::exchange(pending_barriers, 0); }
+
+            static void set_cache_directory(const std::filesystem::path& directory) { cache_directory = directory; }
+            static CacheStatistics get_cache_statistics() { return cache_statistics; }
 
         private:
             void load(std::string_view vertex_shader_file, std::string_view fragment_shader_file);
+            void load(std::string_view compute_shader_file);
+            void build(const std::vector<Stage>& stages);
+            void reflect();
     };
-}
\ No newline at end of file
+}
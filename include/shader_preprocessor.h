@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+
+namespace Engine {
+    // "NAME" or "NAME VALUE", emitted as #define lines right after #version
+    using ShaderDefines = std::vector<std::string>;
+
+    class ShaderPreprocessor {
+    public:
+        struct Result {
+            std::string source;
+            // files[i] is glsl source string i in #line directives and info logs, files[0] is the stage itself
+            std::vector<std::filesystem::path> files;
+            bool success {true};
+        };
+
+        // resolves #include "file" relative to the including file, each file is pasted at most once
+        static Result process(const std::filesystem::path& file, const ShaderDefines& defines = {});
+
+        // appends which file every source string number in a driver info log refers to
+        static std::string annotate_log(std::string_view log, const std::vector<std::filesystem::path>& files);
+    };
+}
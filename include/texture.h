@@ -4,6 +4,7 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <algorithm>
 #include "glad/glad.h"
 #include "stb_image.h"
 
@@ -15,6 +16,11 @@ namespace Engine {
             std::string_view file_path;
             unsigned int width;
             unsigned int height;
+            // GL_TEXTURE_2D_ARRAY only, 0 is taken as 1
+            unsigned int layers;
+            // mip levels to allocate, 0 is taken as 1. a mipmap `filter` only applies to minification, magnification takes
+            // its linear or nearest counterpart
+            unsigned int levels;
             GLenum format;
             GLenum filter;
             GLenum wrap;
@@ -26,9 +32,25 @@ namespace Engine {
         ~Texture();
         void bind(GLuint unit = 0);
         void refactor(unsigned int width, unsigned int height);
+        // `layer` selects the slice of an array texture and is ignored otherwise
+        void upload(const void* data, GLenum format, GLenum type, unsigned int layer = 0);
+        // copies from a pixel buffer on the gpu, `offset` bytes into `buffer`
+        void upload(GLuint buffer, GLintptr offset, GLenum format, GLenum type, unsigned int layer = 0);
+        // zeroes every texel of level 0
+        void clear();
+        // rebuilds every level below 0 from level 0, for all layers
+        void generate_mipmaps();
         unsigned int get_id() { return id; }
+        unsigned int get_width() { return create_info.width; }
+        unsigned int get_height() { return create_info.height; }
+        unsigned int get_layers() { return std::max(create_info.layers, 1u); }
+        unsigned int get_levels() { return std::max(create_info.levels, 1u); }
+        GLenum get_target() { return target; }
 
     private:
+        // creates `id` with the parameters and immutable storage `create_info` describes
+        void allocate();
+
         unsigned int id;
         GLenum target;
         TextureCreateInfo create_info;
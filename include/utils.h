@@ -50,12 +50,6 @@ namespace Utils {
     static std::string_view get_file_name(std::string_view path) {
         return std::filesystem::path(path).filename().string();
     }
-
-    static std::complex<double> complex_exp(double frequency, double time) {
-        constexpr std::complex<double> i(0, 1);
-        std::complex<double> result = exp(2.f * std::numbers::pi * frequency * i * time);
-        return result;
-    }
 }
 
 namespace Engine::Time {
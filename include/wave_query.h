@@ -0,0 +1,62 @@
+#pragma once
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "transform.h"
+
+namespace Engine {
+    // cpu mirror of the ocean vertex shader's displacement lookup (shaders/common/wave_sampling.glsl): the same manual
+    // bilinear fetches with repeat wrapping, blended between the previous and current state of every cascade and summed
+    // over the cascades in the same order of operations. the vertices match it only where they weight every cascade
+    // fully, which with the defaults is the inner part of the finest clipmap level, about 12 m around the camera. past
+    // that the geometry fades out cascades its spacing cannot resolve while the query keeps the whole surface, which is
+    // what the fragments shade. normals come from level 0 slopes fetched the same way, while the renderer shades with
+    // the mipmapped ones
+    class WaveQuery {
+    public:
+        enum class Isa {
+            Scalar,
+            Avx2,
+            Neon
+        };
+
+        // one simulation state as uploaded to the displacement (dx, height, dz, -) and slope (sx, sz) textures
+        struct Field {
+            const glm::vec4* displacement;
+            const glm::vec2* slope;
+            uint32_t size;      // power of two
+            float patch_size;
+        };
+
+        // one cascade of the surface: its two states and how far the displayed surface is from one to the other
+        struct Layer {
+            Field previous;
+            Field current;
+            float blend;
+        };
+
+        // structure of arrays so every member maps straight onto simd lanes; every span holds the same number of points
+        struct Batch {
+            std::span<const float> x;
+            std::span<const float> z;
+            std::span<float> height;
+            std::span<float> displacement_x;
+            std::span<float> displacement_z;
+            std::span<float> normal_x;
+            std::span<float> normal_y;
+            std::span<float> normal_z;
+        };
+
+        // widest instruction set the running cpu supports, picked once
+        static Isa get_isa();
+        static std::string_view isa_to_string_view(Isa isa);
+
+        // the surface is the sum of `layers` in order. with `iterations` > 0 the fixed-point iteration p = (x, z) - D(p) first
+        // finds the lattice point the horizontal displacement moves onto (x, z), so the results describe the rendered surface
+        // above (x, z) rather than the point itself
+        static void sample(std::span<const Layer> layers, const Batch& batch, size_t iterations = 0);
+        // same results as sample(), restricted to `isa` (falls back to scalar when unsupported); for benchmarks and checks
+        static void sample(Isa isa, std::span<const Layer> layers, const Batch& batch, size_t iterations = 0);
+    };
+}
@@ -19,6 +19,7 @@ namespace Engine {
         Window(int width, int height, std::string_view title);
         ~Window();
         void run();
+        Game::Renderer* get_renderer();
 
     private:
         GLFWwindow* window;
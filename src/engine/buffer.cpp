@@ -1,4 +1,7 @@
 #include "buffer.h"
+#include <chrono>
+#include <algorithm>
+#include "utils.h"
 
 namespace Engine {
     Buffer::Buffer() {
@@ -9,7 +12,7 @@ namespace Engine {
         glDeleteBuffers(1, &id);
     }
 
-    void Buffer::data(void* data, size_t data_size) {
+    void Buffer::data(const void* data, size_t data_size) {
         glNamedBufferData(id, data_size, data, GL_STATIC_DRAW);
     }
 
@@ -30,6 +33,10 @@ namespace Engine {
         glVertexArrayElementBuffer(id, ebo_id);
     }
 
+    void VAO::bind_index_buffer(GLuint ebo_id) {
+        glVertexArrayElementBuffer(id, ebo_id);
+    }
+
     void VAO::attrib(GLuint index, GLint size, GLenum type, GLboolean normalized, GLuint offset)
     {
         glEnableVertexArrayAttrib(id, index);
@@ -46,11 +53,18 @@ namespace Engine {
 
     void FBO::attach(GLenum attachment, Texture* texture) {
         glNamedFramebufferTexture(id, attachment, texture->get_id(), 0);
-        attachments.push_back(Attachment {
+
+        // re-attaching a point replaces its record instead of adding another one
+        auto existing = std::find_if(attachments.begin(), attachments.end(), [attachment](const Attachment& entry) {
+            return entry.attachment == attachment;
+        });
+        Attachment record {
             .type = GL_TEXTURE,
             .attachment = attachment, 
             .attachment_ptr = reinterpret_cast<void*>(texture)
-        });
+        };
+        if (existing != attachments.end()) *existing = record;
+        else attachments.push_back(record);
     }
 
     void FBO::bind(GLenum target) { 
@@ -62,7 +76,7 @@ namespace Engine {
             if (attachment.type == GL_TEXTURE) {
                 Texture* texture_attachment = reinterpret_cast<Texture*>(attachment.attachment_ptr);
                 texture_attachment->refactor(width, height);
-                attach(attachment.attachment, texture_attachment);
+                glNamedFramebufferTexture(id, attachment.attachment, texture_attachment->get_id(), 0);
             }
         }
     }
@@ -104,4 +118,72 @@ namespace Engine {
         glNamedBufferData(id, data_size, data, GL_STATIC_DRAW);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, id);
     }
+
+    UBO::UBO(size_t size) {
+        glCreateBuffers(1, &id);
+        glNamedBufferStorage(id, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    UBO::~UBO() {
+        glDeleteBuffers(1, &id);
+    }
+
+    void UBO::data(const void* data, size_t data_size, size_t offset) {
+        glNamedBufferSubData(id, offset, data_size, data);
+    }
+
+    void UBO::bind(GLuint index) {
+        glBindBufferBase(GL_UNIFORM_BUFFER, index, id);
+    }
+
+    StreamBuffer::StreamBuffer(size_t frame_size, size_t frames) : frame_size(frame_size), frames(frames), fences(frames, nullptr) {
+        constexpr GLbitfield flags {GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT};
+        glCreateBuffers(1, &id);
+        glNamedBufferStorage(id, frame_size * frames, nullptr, flags);
+        mapping = static_cast<std::byte*>(glMapNamedBufferRange(id, 0, frame_size * frames, flags));
+        if (!mapping) out_error("failed to map a {} byte stream buffer", frame_size * frames);
+    }
+
+    StreamBuffer::~StreamBuffer() {
+        for (GLsync fence : fences) if (fence) glDeleteSync(fence);
+        if (mapping) glUnmapNamedBuffer(id);
+        glDeleteBuffers(1, &id);
+    }
+
+    void StreamBuffer::begin_frame() {
+        if (open) return;
+        open = true;
+        frame = (frame + 1) % frames;
+        head = 0;
+
+        GLsync& fence = fences[frame];
+        if (!fence) return;
+
+        auto start = std::chrono::steady_clock::now();
+        GLbitfield wait_flags {0};
+        while (true) {
+            GLenum result = glClientWaitSync(fence, wait_flags, 1'000'000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+            wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        }
+        wait_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    StreamBuffer::Allocation StreamBuffer::allocate(size_t size, size_t alignment) {
+        const size_t offset = (head + alignment - 1) / alignment * alignment;
+        if (!mapping || !open || offset + size > frame_size) return Allocation {nullptr, 0, 0};
+
+        head = offset + size;
+        const size_t absolute = frame * frame_size + offset;
+        return Allocation {mapping + absolute, static_cast<GLintptr>(absolute), size};
+    }
+
+    void StreamBuffer::end_frame() {
+        if (!open) return;
+        open = false;
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
 }
\ No newline at end of file
@@ -57,7 +57,8 @@ namespace Engine {
                 break;
             }
             case Orbit: {
-                double time {glfwGetTime()};
+                orbit_time += delta_time;
+                double time {orbit_time};
                 const float amplitude {18.f};
                 float frequency {speed / (DEFAULT_CAMERA_SPEED * 2.f)};
                 position = glm::vec3(amplitude * cos(time * frequency), 14.f, amplitude * sin(time * frequency));
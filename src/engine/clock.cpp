@@ -0,0 +1,39 @@
+#include "clock.h"
+#include <algorithm>
+
+namespace Engine::Time {
+    SimulationClock::SimulationClock(double timestep, size_t max_steps) : timestep(timestep), max_steps(max_steps) {}
+
+    size_t SimulationClock::advance(double delta_time) {
+        accumulator += std::max(delta_time, 0.);
+
+        size_t steps {0};
+        while (accumulator >= timestep && steps < max_steps) {
+            accumulator -= timestep;
+            steps++;
+        }
+
+        // a stall (breakpoint, window drag, shader rebuild) slows the simulation down rather than spiralling into catch-up
+        if (accumulator >= timestep) {
+            dropped_time += accumulator - timestep;
+            accumulator = timestep;
+        }
+
+        step += steps;
+        return steps;
+    }
+
+    void SimulationClock::reset() {
+        origin = 0.;
+        step = 0;
+        accumulator = 0.;
+        dropped_time = 0.;
+    }
+
+    void SimulationClock::set_timestep(double new_timestep) {
+        origin = get_time();
+        step = 0;
+        timestep = new_timestep;
+        accumulator = std::min(accumulator, timestep);
+    }
+}
@@ -0,0 +1,375 @@
+#include "fft.h"
+#include <cmath>
+#include <numbers>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Engine::FFT {
+    namespace {
+        template <typename T>
+        using Complex = std::complex<T>;
+
+        // std::complex operator* goes through __mulsc3 for nan/inf handling, which is far too slow for butterflies
+        template <typename T>
+        inline Complex<T> mul(Complex<T> a, Complex<T> b) {
+            return Complex<T>(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+        }
+
+        template <bool Inverse, typename T>
+        inline Complex<T> twiddle(const Complex<T>* twiddles, size_t index) {
+            return Inverse ? std::conj(twiddles[index]) : twiddles[index];
+        }
+
+        // multiply by -i (forward) or +i (inverse)
+        template <bool Inverse, typename T>
+        inline Complex<T> rotate(Complex<T> value) {
+            return Inverse ? Complex<T>(-value.imag(), value.real()) : Complex<T>(value.imag(), -value.real());
+        }
+
+        template <typename T>
+        struct Simd {
+            static constexpr size_t width {0};
+        };
+
+#if defined(__SSE2__)
+        template <>
+        struct Simd<float> {
+            using Register = __m128;
+            static constexpr size_t width {2};
+
+            static Register load(const Complex<float>* pointer) { return _mm_loadu_ps(reinterpret_cast<const float*>(pointer)); }
+            static void store(Complex<float>* pointer, Register value) { _mm_storeu_ps(reinterpret_cast<float*>(pointer), value); }
+            static Register add(Register a, Register b) { return _mm_add_ps(a, b); }
+            static Register sub(Register a, Register b) { return _mm_sub_ps(a, b); }
+
+            static Register mul(Register a, Complex<float> w) {
+                Register real = _mm_set1_ps(w.real());
+                Register imag = _mm_set_ps(w.imag(), -w.imag(), w.imag(), -w.imag());
+                Register swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+                return _mm_add_ps(_mm_mul_ps(a, real), _mm_mul_ps(swapped, imag));
+            }
+
+            template <bool Inverse>
+            static Register rotate(Register a) {
+                Register swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+                Register sign = Inverse ? _mm_set_ps(0.f, -0.f, 0.f, -0.f) : _mm_set_ps(-0.f, 0.f, -0.f, 0.f);
+                return _mm_xor_ps(swapped, sign);
+            }
+        };
+
+        template <>
+        struct Simd<double> {
+            using Register = __m128d;
+            static constexpr size_t width {1};
+
+            static Register load(const Complex<double>* pointer) { return _mm_loadu_pd(reinterpret_cast<const double*>(pointer)); }
+            static void store(Complex<double>* pointer, Register value) { _mm_storeu_pd(reinterpret_cast<double*>(pointer), value); }
+            static Register add(Register a, Register b) { return _mm_add_pd(a, b); }
+            static Register sub(Register a, Register b) { return _mm_sub_pd(a, b); }
+
+            static Register mul(Register a, Complex<double> w) {
+                Register real = _mm_set1_pd(w.real());
+                Register imag = _mm_set_pd(w.imag(), -w.imag());
+                Register swapped = _mm_shuffle_pd(a, a, 1);
+                return _mm_add_pd(_mm_mul_pd(a, real), _mm_mul_pd(swapped, imag));
+            }
+
+            template <bool Inverse>
+            static Register rotate(Register a) {
+                Register swapped = _mm_shuffle_pd(a, a, 1);
+                Register sign = Inverse ? _mm_set_pd(0., -0.) : _mm_set_pd(-0., 0.);
+                return _mm_xor_pd(swapped, sign);
+            }
+        };
+#endif
+
+        // one stockham pass: `n` is the length of the sub transforms still to be done, `s` the stride between them
+        template <bool Inverse, typename T>
+        void pass_radix2(const Complex<T>* x, Complex<T>* y, size_t size, size_t n, size_t s, const Complex<T>* twiddles) {
+            const size_t m {n / 2};
+            const size_t step {size / n};
+
+            for (size_t p {0}; p < m; p++) {
+                const Complex<T> w1 = twiddle<Inverse>(twiddles, p * step);
+                const Complex<T>* x0 = x + s * p;
+                const Complex<T>* x1 = x + s * (p + m);
+                Complex<T>* y0 = y + s * (2 * p);
+                Complex<T>* y1 = y0 + s;
+
+                size_t q {0};
+                if constexpr (Simd<T>::width > 0) {
+                    using S = Simd<T>;
+                    for (; q + S::width <= s; q += S::width) {
+                        auto a = S::load(x0 + q);
+                        auto b = S::load(x1 + q);
+                        S::store(y0 + q, S::add(a, b));
+                        S::store(y1 + q, S::mul(S::sub(a, b), w1));
+                    }
+                }
+
+                for (; q < s; q++) {
+                    const Complex<T> a = x0[q];
+                    const Complex<T> b = x1[q];
+                    y0[q] = a + b;
+                    y1[q] = mul(a - b, w1);
+                }
+            }
+        }
+
+        template <bool Inverse, typename T>
+        void pass_radix4(const Complex<T>* x, Complex<T>* y, size_t size, size_t n, size_t s, const Complex<T>* twiddles) {
+            const size_t m {n / 4};
+            const size_t step {size / n};
+
+            for (size_t p {0}; p < m; p++) {
+                const Complex<T> w1 = twiddle<Inverse>(twiddles, p * step);
+                const Complex<T> w2 = twiddle<Inverse>(twiddles, 2 * p * step);
+                const Complex<T> w3 = twiddle<Inverse>(twiddles, 3 * p * step);
+                const Complex<T>* x0 = x + s * p;
+                const Complex<T>* x1 = x + s * (p + m);
+                const Complex<T>* x2 = x + s * (p + 2 * m);
+                const Complex<T>* x3 = x + s * (p + 3 * m);
+                Complex<T>* y0 = y + s * (4 * p);
+                Complex<T>* y1 = y0 + s;
+                Complex<T>* y2 = y1 + s;
+                Complex<T>* y3 = y2 + s;
+
+                size_t q {0};
+                if constexpr (Simd<T>::width > 0) {
+                    using S = Simd<T>;
+                    for (; q + S::width <= s; q += S::width) {
+                        auto a0 = S::load(x0 + q);
+                        auto a1 = S::load(x1 + q);
+                        auto a2 = S::load(x2 + q);
+                        auto a3 = S::load(x3 + q);
+                        auto b0 = S::add(a0, a2);
+                        auto b1 = S::sub(a0, a2);
+                        auto b2 = S::add(a1, a3);
+                        auto b3 = S::template rotate<Inverse>(S::sub(a1, a3));
+                        S::store(y0 + q, S::add(b0, b2));
+                        S::store(y1 + q, S::mul(S::add(b1, b3), w1));
+                        S::store(y2 + q, S::mul(S::sub(b0, b2), w2));
+                        S::store(y3 + q, S::mul(S::sub(b1, b3), w3));
+                    }
+                }
+
+                for (; q < s; q++) {
+                    const Complex<T> b0 = x0[q] + x2[q];
+                    const Complex<T> b1 = x0[q] - x2[q];
+                    const Complex<T> b2 = x1[q] + x3[q];
+                    const Complex<T> b3 = rotate<Inverse>(x1[q] - x3[q]);
+                    y0[q] = b0 + b2;
+                    y1[q] = mul(b1 + b3, w1);
+                    y2[q] = mul(b0 - b2, w2);
+                    y3[q] = mul(b1 - b3, w3);
+                }
+            }
+        }
+
+        template <bool Inverse, typename T>
+        void pass_radix3(const Complex<T>* x, Complex<T>* y, size_t size, size_t n, size_t s, const Complex<T>* twiddles) {
+            const size_t m {n / 3};
+            const size_t step {size / n};
+            const T sin60 = static_cast<T>(std::numbers::sqrt3 / 2.);
+
+            for (size_t p {0}; p < m; p++) {
+                const Complex<T> w1 = twiddle<Inverse>(twiddles, p * step);
+                const Complex<T> w2 = twiddle<Inverse>(twiddles, 2 * p * step);
+
+                for (size_t q {0}; q < s; q++) {
+                    const Complex<T> a0 = x[q + s * p];
+                    const Complex<T> a1 = x[q + s * (p + m)];
+                    const Complex<T> a2 = x[q + s * (p + 2 * m)];
+                    const Complex<T> t = a1 + a2;
+                    const Complex<T> u = a0 - t * static_cast<T>(.5);
+                    const Complex<T> v = rotate<Inverse>(a1 - a2) * sin60;
+                    y[q + s * (3 * p)] = a0 + t;
+                    y[q + s * (3 * p + 1)] = mul(u + v, w1);
+                    y[q + s * (3 * p + 2)] = mul(u - v, w2);
+                }
+            }
+        }
+
+        template <bool Inverse, typename T>
+        void pass_generic(const Complex<T>* x, Complex<T>* y, size_t size, size_t n, size_t s, size_t radix, const Complex<T>* twiddles, Complex<T>* buffer) {
+            const size_t m {n / radix};
+            const size_t step {size / n};
+            const size_t root_step {size / radix};
+
+            for (size_t p {0}; p < m; p++) {
+                for (size_t q {0}; q < s; q++) {
+                    for (size_t r {0}; r < radix; r++)
+                        buffer[r] = x[q + s * (p + r * m)];
+
+                    for (size_t k {0}; k < radix; k++) {
+                        Complex<T> sum = buffer[0];
+                        for (size_t r {1}; r < radix; r++)
+                            sum += mul(buffer[r], twiddle<Inverse>(twiddles, ((r * k) % radix) * root_step));
+                        y[q + s * (radix * p + k)] = mul(sum, twiddle<Inverse>(twiddles, k * p * step));
+                    }
+                }
+            }
+        }
+
+        template <typename T>
+        std::vector<Complex<T>>& scratch_buffer(size_t slot, size_t size) {
+            thread_local std::vector<Complex<T>> buffers[3];
+            std::vector<Complex<T>>& buffer = buffers[slot];
+            if (buffer.size() < size) buffer.resize(size);
+            return buffer;
+        }
+
+        template <bool Inverse, typename T>
+        void run_passes(Complex<T>* data, Complex<T>* scratch, size_t size, const std::vector<size_t>& factors, const Complex<T>* twiddles) {
+            Complex<T>* x = data;
+            Complex<T>* y = scratch;
+            size_t n {size};
+            size_t s {1};
+
+            for (size_t radix : factors) {
+                switch (radix) {
+                    case 4: pass_radix4<Inverse>(x, y, size, n, s, twiddles); break;
+                    case 2: pass_radix2<Inverse>(x, y, size, n, s, twiddles); break;
+                    case 3: pass_radix3<Inverse>(x, y, size, n, s, twiddles); break;
+                    default: pass_generic<Inverse>(x, y, size, n, s, radix, twiddles, scratch_buffer<T>(2, radix).data()); break;
+                }
+                n /= radix;
+                s *= radix;
+                std::swap(x, y);
+            }
+
+            if (x != data) std::copy(x, x + size, data);
+        }
+
+        template <typename T>
+        std::vector<Complex<T>> make_twiddles(size_t size, size_t count) {
+            std::vector<Complex<T>> twiddles(count);
+            for (size_t k {0}; k < count; k++) {
+                double angle = -2. * std::numbers::pi * static_cast<double>(k) / static_cast<double>(size);
+                twiddles[k] = Complex<T>(static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle)));
+            }
+            return twiddles;
+        }
+    }
+
+    template <typename T>
+    Plan<T>::Plan(size_t size) : size(size) {
+        size_t remaining {size};
+        while (remaining % 4 == 0) { factors.push_back(4); remaining /= 4; }
+        for (size_t radix {2}; remaining > 1; radix++) {
+            while (remaining % radix == 0) { factors.push_back(radix); remaining /= radix; }
+        }
+
+        twiddles = make_twiddles<T>(size, size);
+    }
+
+    template <typename T>
+    void Plan<T>::execute(std::complex<T>* data, std::complex<T>* scratch, Direction direction) const {
+        if (size <= 1) return;
+        if (direction == Direction::Forward) run_passes<false>(data, scratch, size, factors, twiddles.data());
+        else run_passes<true>(data, scratch, size, factors, twiddles.data());
+    }
+
+    template <typename T>
+    void Plan<T>::execute(std::complex<T>* data, Direction direction) const {
+        execute(data, scratch_buffer<T>(0, size).data(), direction);
+    }
+
+    template <typename T>
+    RealPlan<T>::RealPlan(size_t size) : size(size) {
+        if (size % 2 == 0) {
+            complex_plan = get_plan<T>(size / 2);
+            twiddles = make_twiddles<T>(size, size / 2 + 1);
+        }
+        else {
+            complex_plan = get_plan<T>(size);
+        }
+    }
+
+    template <typename T>
+    void RealPlan<T>::forward(const T* input, std::complex<T>* output) const {
+        const size_t bins {get_bins()};
+
+        if (size % 2 != 0) {
+            std::vector<Complex<T>>& buffer = scratch_buffer<T>(1, size);
+            for (size_t i {0}; i < size; i++) buffer[i] = Complex<T>(input[i], 0);
+            complex_plan->execute(buffer.data(), Direction::Forward);
+            std::copy(buffer.begin(), buffer.begin() + bins, output);
+            return;
+        }
+
+        const size_t half {size / 2};
+        std::vector<Complex<T>>& z = scratch_buffer<T>(1, half);
+        for (size_t k {0}; k < half; k++) z[k] = Complex<T>(input[2 * k], input[2 * k + 1]);
+        complex_plan->execute(z.data(), Direction::Forward);
+
+        for (size_t k {0}; k < bins; k++) {
+            const Complex<T> a = z[k % half];
+            const Complex<T> b = std::conj(z[(half - k) % half]);
+            const Complex<T> even = (a + b) * static_cast<T>(.5);
+            const Complex<T> odd = rotate<false>(a - b) * static_cast<T>(.5);
+            output[k] = even + mul(twiddles[k], odd);
+        }
+    }
+
+    template <typename T>
+    void RealPlan<T>::inverse(const std::complex<T>* input, T* output) const {
+        if (size % 2 != 0) {
+            std::vector<Complex<T>>& buffer = scratch_buffer<T>(1, size);
+            for (size_t k {0}; k < size; k++) buffer[k] = k < get_bins() ? input[k] : std::conj(input[size - k]);
+            complex_plan->execute(buffer.data(), Direction::Inverse);
+            for (size_t i {0}; i < size; i++) output[i] = buffer[i].real();
+            return;
+        }
+
+        const size_t half {size / 2};
+        std::vector<Complex<T>>& z = scratch_buffer<T>(1, half);
+        for (size_t k {0}; k < half; k++) {
+            const Complex<T> a = input[k];
+            const Complex<T> b = std::conj(input[half - k]);
+            z[k] = (a + b) + rotate<true>(mul(std::conj(twiddles[k]), a - b));
+        }
+        complex_plan->execute(z.data(), Direction::Inverse);
+
+        for (size_t k {0}; k < half; k++) {
+            output[2 * k] = z[k].real();
+            output[2 * k + 1] = z[k].imag();
+        }
+    }
+
+    template <typename T>
+    std::shared_ptr<const Plan<T>> get_plan(size_t size) {
+        static std::mutex mutex;
+        static std::unordered_map<size_t, std::shared_ptr<const Plan<T>>> plans;
+
+        std::lock_guard lock(mutex);
+        std::shared_ptr<const Plan<T>>& plan = plans[size];
+        if (!plan) plan = std::make_shared<const Plan<T>>(size);
+        return plan;
+    }
+
+    template <typename T>
+    std::shared_ptr<const RealPlan<T>> get_real_plan(size_t size) {
+        static std::mutex mutex;
+        static std::unordered_map<size_t, std::shared_ptr<const RealPlan<T>>> plans;
+
+        std::lock_guard lock(mutex);
+        std::shared_ptr<const RealPlan<T>>& plan = plans[size];
+        if (!plan) plan = std::make_shared<const RealPlan<T>>(size);
+        return plan;
+    }
+
+    template class Plan<float>;
+    template class Plan<double>;
+    template class RealPlan<float>;
+    template class RealPlan<double>;
+
+    template std::shared_ptr<const Plan<float>> get_plan<float>(size_t);
+    template std::shared_ptr<const Plan<double>> get_plan<double>(size_t);
+    template std::shared_ptr<const RealPlan<float>> get_real_plan<float>(size_t);
+    template std::shared_ptr<const RealPlan<double>> get_real_plan<double>(size_t);
+}
@@ -0,0 +1,111 @@
+#include "file_watcher.h"
+#include "utils.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace Engine {
+    namespace {
+        // editors often write a file in several steps, wait until it has been quiet for a moment
+        constexpr std::chrono::milliseconds DEBOUNCE {50};
+        constexpr int POLL_INTERVAL_MS {100};
+    }
+
+    FileWatcher::FileWatcher() {
+#ifdef __linux__
+        descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (descriptor < 0) {
+            out_warn("inotify is unavailable, shader files will not be watched");
+            return;
+        }
+#endif
+        thread = std::thread(&FileWatcher::run, this);
+    }
+
+    FileWatcher::~FileWatcher() {
+        running = false;
+        if (thread.joinable()) thread.join();
+#ifdef __linux__
+        if (descriptor >= 0) close(descriptor);
+#endif
+    }
+
+    void FileWatcher::watch(const std::filesystem::path& file) {
+        const std::filesystem::path path = std::filesystem::weakly_canonical(file);
+        std::lock_guard lock(mutex);
+        if (!files.insert(path).second) return;
+
+#ifdef __linux__
+        if (descriptor < 0) return;
+
+        // the directory is watched rather than the file, so saves that replace the file by renaming are still seen
+        const std::filesystem::path directory = path.parent_path();
+        for (const auto& [watch, watched_directory] : directories)
+            if (watched_directory == directory) return;
+
+        int watch = inotify_add_watch(descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (watch < 0) out_warn("failed to watch {}", directory.string());
+        else directories[watch] = directory;
+#else
+        std::error_code error;
+        timestamps[path] = std::filesystem::last_write_time(path, error);
+#endif
+    }
+
+    std::vector<std::filesystem::path> FileWatcher::poll_changes() {
+        std::vector<std::filesystem::path> settled;
+        const auto now = Clock::now();
+
+        std::lock_guard lock(mutex);
+        for (auto it = changes.begin(); it != changes.end();) {
+            if (now - it->second < DEBOUNCE) { ++it; continue; }
+            settled.push_back(it->first);
+            it = changes.erase(it);
+        }
+        return settled;
+    }
+
+    void FileWatcher::record_change(const std::filesystem::path& file) {
+        if (files.contains(file)) changes[file] = Clock::now();
+    }
+
+    void FileWatcher::run() {
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        pollfd descriptors {descriptor, POLLIN, 0};
+
+        while (running) {
+            if (poll(&descriptors, 1, POLL_INTERVAL_MS) <= 0) continue;
+
+            ssize_t length;
+            while ((length = read(descriptor, buffer, sizeof(buffer))) > 0) {
+                std::lock_guard lock(mutex);
+                for (char* cursor = buffer; cursor < buffer + length;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+                    cursor += sizeof(inotify_event) + event->len;
+
+                    auto directory = directories.find(event->wd);
+                    if (directory != directories.end() && event->len > 0)
+                        record_change(directory->second / event->name);
+                }
+            }
+        }
+#else
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+
+            std::lock_guard lock(mutex);
+            for (auto& [file, timestamp] : timestamps) {
+                std::error_code error;
+                auto current = std::filesystem::last_write_time(file, error);
+                if (error || current == timestamp) continue;
+                timestamp = current;
+                record_change(file);
+            }
+        }
+#endif
+    }
+}
@@ -0,0 +1,250 @@
+#include "frame_graph.h"
+#include <algorithm>
+#include <bit>
+#include <imgui.h>
+#include "shader.h"
+#include "profiler.h"
+#include "utils.h"
+
+namespace Engine {
+    namespace {
+        // only image stores and storage buffer writes bypass gl's implicit ordering
+        bool is_incoherent(FrameGraph::Usage usage) {
+            return usage == FrameGraph::Usage::Image || usage == FrameGraph::Usage::Storage;
+        }
+
+        GLbitfield consumer_barrier(FrameGraph::Usage usage) {
+            switch (usage) {
+                case FrameGraph::Usage::Sampled: return GL_TEXTURE_FETCH_BARRIER_BIT;
+                case FrameGraph::Usage::Image: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+                case FrameGraph::Usage::Attachment: return GL_FRAMEBUFFER_BARRIER_BIT;
+                case FrameGraph::Usage::Storage: return GL_SHADER_STORAGE_BARRIER_BIT;
+                case FrameGraph::Usage::Transfer: return GL_TEXTURE_UPDATE_BARRIER_BIT;
+            }
+            return 0;
+        }
+    }
+
+    FrameGraph::Resource FrameGraph::Builder::create(std::string_view name, const RenderTargetPool::Description& description) {
+        graph.resources.push_back(ResourceNode {.name = std::string(name), .description = description});
+        return write(graph.resources.size() - 1, Usage::Attachment);
+    }
+
+    FrameGraph::Resource FrameGraph::Builder::read(Resource resource, Usage usage) {
+        graph.passes[pass].accesses.push_back(Access {resource, usage, false});
+        graph.resources[resource].readers++;
+        return resource;
+    }
+
+    FrameGraph::Resource FrameGraph::Builder::write(Resource resource, Usage usage) {
+        std::vector<Access>& accesses = graph.passes[pass].accesses;
+
+        // create() already recorded the write, a later write() only refines its usage
+        auto existing = std::find_if(accesses.begin(), accesses.end(), [resource](const Access& access) { return access.resource == resource && access.write; });
+        if (existing != accesses.end()) {
+            existing->usage = usage;
+            return resource;
+        }
+
+        accesses.push_back(Access {resource, usage, true});
+        graph.resources[resource].writers.push_back(pass);
+        graph.passes[pass].references++;
+        return resource;
+    }
+
+    Texture* FrameGraph::Context::get_texture(Resource resource) {
+        return graph.resources[resource].texture;
+    }
+
+    glm::uvec2 FrameGraph::Context::get_size(Resource resource) {
+        return graph.resources[resource].description.size;
+    }
+
+    void FrameGraph::Context::bind_framebuffer(std::initializer_list<Resource> colors, Resource depth) {
+        std::vector<GLuint> key;
+        for (Resource color : colors) key.push_back(get_texture(color)->get_id());
+        key.push_back(depth == NONE ? 0 : get_texture(depth)->get_id());
+
+        CachedFramebuffer& cached = graph.framebuffers[key];
+        if (!cached.framebuffer) {
+            cached.framebuffer = std::make_unique<FBO>();
+
+            std::vector<GLenum> draw_buffers;
+            for (Resource color : colors) {
+                const GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(draw_buffers.size());
+                cached.framebuffer->attach(attachment, get_texture(color));
+                draw_buffers.push_back(attachment);
+            }
+            if (depth != NONE) cached.framebuffer->attach(GL_DEPTH_ATTACHMENT, get_texture(depth));
+            cached.framebuffer->set_draw_buffers(draw_buffers);
+            cached.framebuffer->status();
+        }
+        cached.last_frame = graph.frame;
+
+        cached.framebuffer->bind();
+        const glm::uvec2 size = get_size(colors.size() ? *colors.begin() : depth);
+        glViewport(0, 0, size.x, size.y);
+    }
+
+    FrameGraph::FrameGraph(RenderTargetPool& pool) : pool(pool) {}
+
+    FrameGraph::Resource FrameGraph::import_texture(std::string_view name, Texture* texture, glm::uvec2 size) {
+        resources.push_back(ResourceNode {.name = std::string(name), .texture = texture, .imported = true});
+        resources.back().description.size = size;
+        return resources.size() - 1;
+    }
+
+    void FrameGraph::set_output(Resource resource) {
+        resources[resource].output = true;
+    }
+
+    void FrameGraph::add_pass(std::string_view name, const std::function<void(Builder&)>& setup, std::function<void(Context&)> execute) {
+        passes.push_back(PassNode {.name = std::string(name), .execute = std::move(execute)});
+        Builder builder(*this, passes.size() - 1);
+        setup(builder);
+    }
+
+    void FrameGraph::cull() {
+        std::vector<size_t> references(resources.size());
+        std::vector<Resource> unreferenced;
+        for (Resource resource {0}; resource < resources.size(); resource++) {
+            references[resource] = resources[resource].readers + (resources[resource].output ? 1 : 0);
+            if (references[resource] == 0) unreferenced.push_back(resource);
+        }
+
+        while (!unreferenced.empty()) {
+            Resource resource = unreferenced.back();
+            unreferenced.pop_back();
+
+            for (size_t writer : resources[resource].writers) {
+                PassNode& pass = passes[writer];
+                if (pass.references == 0 || --pass.references > 0) continue;
+
+                pass.culled = true;
+                for (const Access& access : pass.accesses) {
+                    if (access.write || references[access.resource] == 0) continue;
+                    if (--references[access.resource] == 0) unreferenced.push_back(access.resource);
+                }
+            }
+        }
+    }
+
+    // a barrier is only issued for the first consumer of each kind after an incoherent write. imported textures outlive
+    // the frame, so a write left unconsumed at the end of one is still pending at the start of the next
+    void FrameGraph::compute_barriers() {
+        std::vector<bool> dirty(resources.size(), false);
+        std::vector<GLbitfield> visible(resources.size(), 0);
+        for (size_t index {0}; index < resources.size(); index++) {
+            if (!resources[index].imported) continue;
+            auto state = imported_writes.find(resources[index].texture);
+            if (state == imported_writes.end()) continue;
+            dirty[index] = true;
+            visible[index] = state->second;
+        }
+
+        for (size_t index {0}; index < passes.size(); index++) {
+            PassNode& pass = passes[index];
+            if (pass.culled) continue;
+
+            for (const Access& access : pass.accesses) {
+                ResourceNode& resource = resources[access.resource];
+                if (resource.first_pass == NONE) resource.first_pass = index;
+                resource.last_pass = index;
+
+                const GLbitfield barrier = consumer_barrier(access.usage);
+                if (dirty[access.resource] && !(visible[access.resource] & barrier)) {
+                    pass.barriers |= barrier;
+                    visible[access.resource] |= barrier;
+                }
+            }
+
+            for (const Access& access : pass.accesses) {
+                if (!access.write) continue;
+                dirty[access.resource] = is_incoherent(access.usage);
+                visible[access.resource] = 0;
+            }
+        }
+
+        for (size_t index {0}; index < resources.size(); index++) {
+            if (!resources[index].imported) continue;
+            if (dirty[index]) imported_writes[resources[index].texture] = visible[index];
+            else imported_writes.erase(resources[index].texture);
+        }
+    }
+
+    void FrameGraph::execute() {
+        cull();
+        compute_barriers();
+
+        reports.clear();
+        requested_bytes = 0;
+        barrier_count = 0;
+        Context context(*this);
+
+        for (size_t index {0}; index < passes.size(); index++) {
+            PassNode& pass = passes[index];
+            PassReport report {pass.name, pass.culled, pass.barriers, 0, 0, 0};
+            for (const Access& access : pass.accesses) (access.write ? report.writes : report.reads)++;
+
+            if (!pass.culled) {
+                // transients are acquired right before their first use, so a target released earlier this frame is aliased
+                for (ResourceNode& resource : resources) {
+                    if (resource.imported || resource.first_pass != index) continue;
+                    resource.texture = pool.acquire(resource.description);
+                    report.transient_bytes += RenderTargetPool::get_bytes(resource.description);
+                }
+                requested_bytes += report.transient_bytes;
+
+                if (pass.barriers) {
+                    glMemoryBarrier(pass.barriers);
+                    barrier_count++;
+                }
+
+                {
+                    Profiler::Scope scope(pass.name);
+                    pass.execute(context);
+                }
+                // the graph has already placed every barrier a later pass needs
+                Shader::take_pending_barriers();
+
+                for (ResourceNode& resource : resources)
+                    if (!resource.imported && resource.last_pass == index) pool.release(resource.texture);
+            }
+
+            reports.push_back(std::move(report));
+        }
+
+        FBO::unbind();
+        resident_bytes = pool.get_allocated_bytes();
+
+        std::erase_if(framebuffers, [this](const auto& entry) { return entry.second.last_frame != frame; });
+        resources.clear();
+        passes.clear();
+        frame++;
+    }
+
+    void FrameGraph::draw_imgui() {
+        if (ImGui::BeginTable("frame-graph", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("pass");
+            ImGui::TableSetupColumn("cpu-ms");
+            ImGui::TableSetupColumn("gpu-ms");
+            ImGui::TableSetupColumn("reads/writes");
+            ImGui::TableSetupColumn("barriers");
+            ImGui::TableSetupColumn("transient");
+            ImGui::TableHeadersRow();
+
+            for (const PassReport& report : reports) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text(std::format("{}{}", report.name, report.culled ? " (culled)" : "").c_str());
+                ImGui::TableNextColumn(); ImGui::Text(std::format("{:.3f}", Profiler::get_cpu_statistics(report.name).average).c_str());
+                ImGui::TableNextColumn(); ImGui::Text(std::format("{:.3f}", Profiler::get_gpu_statistics(report.name).average).c_str());
+                ImGui::TableNextColumn(); ImGui::Text(std::format("{}/{}", report.reads, report.writes).c_str());
+                ImGui::TableNextColumn(); ImGui::Text(std::format("{}", std::popcount(report.barriers)).c_str());
+                ImGui::TableNextColumn(); ImGui::Text(std::format("{:.2f} MiB", report.transient_bytes / 1048576.).c_str());
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::Text(std::format("transients: {:.2f} MiB requested, pool {:.2f} MiB resident, {} barriers", requested_bytes / 1048576., resident_bytes / 1048576., barrier_count).c_str());
+    }
+}
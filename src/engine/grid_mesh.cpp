@@ -0,0 +1,153 @@
+#include "grid_mesh.h"
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include "jobs.h"
+
+namespace Engine {
+    GridMeshBuilder::GridMeshBuilder(size_t cells, Layout layout) : cells(cells), layout(layout) {
+        // the largest value of the type is reserved for primitive restart
+        wide = get_vertex_count() > std::numeric_limits<uint16_t>::max();
+    }
+
+    GridMeshBuilder::Range GridMeshBuilder::add(size_t hole_min_x, size_t hole_min_z, size_t hole_max_x, size_t hole_max_z) {
+        return wide
+            ? emit(indices32, hole_min_x, hole_min_z, hole_max_x, hole_max_z)
+            : emit(indices16, hole_min_x, hole_min_z, hole_max_x, hole_max_z);
+    }
+
+    // every (band, row) pair is one unit; their sizes are known up front, so the units are written in parallel
+    template <typename T>
+    GridMeshBuilder::Range GridMeshBuilder::emit(std::vector<T>& indices, size_t hole_min_x, size_t hole_min_z, size_t hole_max_x, size_t hole_max_z) {
+        constexpr T RESTART {std::numeric_limits<T>::max()};
+        const bool strips {layout == Layout::Strips};
+        const size_t band {layout == Layout::RowMajor ? cells : BAND_WIDTH};
+        const size_t bands {(cells + band - 1) / band};
+        const size_t units {bands * cells};
+        const size_t row {cells + 1};
+        const bool hole {hole_min_x < hole_max_x && hole_min_z < hole_max_z};
+
+        // a unit is split into at most two runs of cells by the hole
+        auto runs = [&](size_t unit, size_t (&begin)[2], size_t (&end)[2]) -> size_t {
+            const size_t z {unit % cells};
+            const size_t x0 {(unit / cells) * band};
+            const size_t x1 {std::min(x0 + band, cells)};
+
+            if (!hole || z < hole_min_z || z >= hole_max_z) {
+                begin[0] = x0;
+                end[0] = x1;
+                return 1;
+            }
+
+            size_t count {0};
+            if (x0 < std::min(x1, hole_min_x)) {
+                begin[count] = x0;
+                end[count++] = std::min(x1, hole_min_x);
+            }
+            if (std::max(x0, hole_max_x) < x1) {
+                begin[count] = std::max(x0, hole_max_x);
+                end[count++] = x1;
+            }
+            return count;
+        };
+
+        auto run_size = [strips](size_t width) { return strips ? 2 * (width + 1) + 1 : 6 * width; };
+
+        std::vector<size_t> offsets(units + 1, 0);
+        for (size_t unit {0}; unit < units; unit++) {
+            size_t begin[2], end[2];
+            const size_t count {runs(unit, begin, end)};
+            offsets[unit + 1] = offsets[unit];
+            for (size_t run {0}; run < count; run++) offsets[unit + 1] += run_size(end[run] - begin[run]);
+        }
+
+        const size_t base {indices.size()};
+        indices.resize(base + offsets[units]);
+
+        Jobs::parallel_for(units, 16, [&](size_t first, size_t last) {
+            for (size_t unit {first}; unit < last; unit++) {
+                T* out {indices.data() + base + offsets[unit]};
+                const size_t z {unit % cells};
+
+                size_t begin[2], end[2];
+                const size_t count {runs(unit, begin, end)};
+
+                for (size_t run {0}; run < count; run++) {
+                    if (strips) {
+                        // top, bottom, top, ... so even triangles are (tl, bl, tr) and odd ones (tr, bl, br), as in the lists
+                        for (size_t x {begin[run]}; x <= end[run]; x++) {
+                            *out++ = static_cast<T>(z * row + x);
+                            *out++ = static_cast<T>((z + 1) * row + x);
+                        }
+                        *out++ = RESTART;
+                        continue;
+                    }
+
+                    for (size_t x {begin[run]}; x < end[run]; x++) {
+                        const T top_left = static_cast<T>(z * row + x);
+                        const T top_right = static_cast<T>(top_left + 1);
+                        const T bottom_left = static_cast<T>(top_left + row);
+                        const T bottom_right = static_cast<T>(bottom_left + 1);
+
+                        *out++ = top_left;
+                        *out++ = bottom_left;
+                        *out++ = top_right;
+
+                        *out++ = top_right;
+                        *out++ = bottom_left;
+                        *out++ = bottom_right;
+                    }
+                }
+            }
+        });
+
+        return Range {base, offsets[units]};
+    }
+
+    GridMeshBuilder::Report GridMeshBuilder::report(const Range& range) const {
+        Report report;
+        report.indices = range.count;
+        report.index_bytes = range.count * get_index_size();
+
+        auto simulate = [&](const auto& indices) {
+            using T = std::decay_t<decltype(indices[0])>;
+            constexpr T RESTART {std::numeric_limits<T>::max()};
+
+            std::vector<bool> used(get_vertex_count(), false);
+            std::vector<size_t> fifo(CACHE_SIZE, SIZE_MAX);
+            size_t head {0};
+            size_t misses {0};
+            size_t strip_length {0};
+
+            for (size_t i {range.offset}; i < range.offset + range.count; i++) {
+                const T index = indices[i];
+                if (layout == Layout::Strips) {
+                    if (index == RESTART) {
+                        strip_length = 0;
+                        continue;
+                    }
+                    if (++strip_length >= 3) report.triangles++;
+                }
+
+                if (std::find(fifo.begin(), fifo.end(), index) == fifo.end()) {
+                    fifo[head] = index;
+                    head = (head + 1) % CACHE_SIZE;
+                    misses++;
+                }
+
+                if (!used[index]) {
+                    used[index] = true;
+                    report.vertices++;
+                }
+            }
+
+            if (layout != Layout::Strips) report.triangles = range.count / 3;
+            report.acmr = report.triangles ? static_cast<float>(misses) / report.triangles : 0.f;
+            report.atvr = report.vertices ? static_cast<float>(misses) / report.vertices : 0.f;
+        };
+
+        if (wide) simulate(indices32);
+        else simulate(indices16);
+        return report;
+    }
+}
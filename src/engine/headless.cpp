@@ -0,0 +1,253 @@
+#include "headless.h"
+#include "ocean_bake.h"
+#include <chrono>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+
+namespace Engine {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        double elapsed_ms(Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        double percentile(std::vector<double> samples, double fraction) {
+            if (samples.empty()) return 0.;
+            std::sort(samples.begin(), samples.end());
+            size_t rank = static_cast<size_t>(std::ceil(fraction * samples.size()));
+            return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+        }
+
+        double mean(const std::vector<double>& samples) {
+            if (samples.empty()) return 0.;
+            double sum {0.};
+            for (double sample : samples) sum += sample;
+            return sum / samples.size();
+        }
+
+        template <typename T>
+        T parse_number(std::string_view text, T fallback) {
+            T value {};
+            auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+                out_warn("invalid number '{}', using {}", text, fallback);
+                return fallback;
+            }
+            return value;
+        }
+    }
+
+    BenchmarkSettings BenchmarkSettings::from_arguments(std::span<char*> arguments) {
+        BenchmarkSettings settings;
+
+        for (size_t i {0}; i < arguments.size(); i++) {
+            std::string_view argument {arguments[i]};
+            auto value = [&]() -> std::string_view { return i + 1 < arguments.size() ? std::string_view(arguments[++i]) : std::string_view(); };
+
+            if (argument == "--frames") settings.frames = parse_number(value(), settings.frames);
+            else if (argument == "--warmup") settings.warmup_frames = parse_number(value(), settings.warmup_frames);
+            else if (argument == "--timestep") settings.timestep = parse_number(value(), settings.timestep);
+            else if (argument == "--width") settings.width = parse_number(value(), settings.width);
+            else if (argument == "--height") settings.height = parse_number(value(), settings.height);
+            else if (argument == "--grid") settings.grid_size = parse_number(value(), settings.grid_size);
+            else if (argument == "--spectrum") settings.spectrum_size = parse_number(value(), settings.spectrum_size);
+            else if (argument == "--bodies") settings.bodies = parse_number(value(), settings.bodies);
+            else if (argument == "--baked") settings.baked_file = value();
+            else if (argument == "--bake") settings.bake_file = value();
+            else if (argument == "--bake-frames") settings.bake_frames = parse_number(value(), settings.bake_frames);
+            else if (argument == "--bake-period") settings.bake_period = parse_number(value(), settings.bake_period);
+            else if (argument == "--output") settings.output_file = value();
+            else if (argument == "--cpu-only") settings.cpu_only = true;
+            else if (argument != "--headless") out_warn("unknown argument '{}'", argument);
+        }
+
+        return settings;
+    }
+
+    Headless::Headless(const BenchmarkSettings& settings) : settings(settings) {}
+
+    Headless::~Headless() {
+        if (window) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
+    }
+
+    bool Headless::create_context() {
+        struct Attempt {
+            int api;
+            const char* description;
+        };
+
+        constexpr Attempt attempts[] {
+            { GLFW_OSMESA_CONTEXT_API, "osmesa (surfaceless)" },
+            { GLFW_EGL_CONTEXT_API, "egl (hidden window)" },
+            { GLFW_NATIVE_CONTEXT_API, "native (hidden window)" },
+        };
+
+        for (const Attempt& attempt : attempts) {
+#ifdef GLFW_PLATFORM_NULL
+            glfwInitHint(GLFW_PLATFORM, attempt.api == GLFW_OSMESA_CONTEXT_API ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
+#endif
+            if (!glfwInit()) continue;
+
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, attempt.api);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+            window = glfwCreateWindow(settings.width, settings.height, "", nullptr, nullptr);
+            if (window) {
+                glfwMakeContextCurrent(window);
+                if (gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+                    context_description = std::format("{} - {}", attempt.description, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+                    return true;
+                }
+                glfwDestroyWindow(window);
+                window = nullptr;
+            }
+
+            glfwTerminate();
+        }
+
+        return false;
+    }
+
+    int Headless::bake() {
+        Game::OceanSettings ocean_settings;
+        ocean_settings.resolution = settings.spectrum_size;
+        ocean_settings.loop_period = settings.bake_period;
+        return Game::OceanBake::write(settings.bake_file, ocean_settings, settings.bake_frames) ? 0 : 1;
+    }
+
+    int Headless::run() {
+        if (!settings.bake_file.empty()) return bake();
+
+        if (!settings.cpu_only && !create_context())
+            out_warn("no opengl context could be created, running the simulation only");
+
+        out("benchmark: {} frames at {:.4f} s ({})", settings.frames, settings.timestep, context_description);
+
+        Game::OceanSettings ocean_settings;
+        ocean_settings.resolution = settings.spectrum_size;
+
+        Game::BuoyancySettings buoyancy_settings;
+        buoyancy_settings.count = settings.bodies;
+
+        std::vector<Stage> stages {{"frame"}, {"simulation"}, {"upload"}, {"render"}, {"buoyancy"}};
+        Stage& frame_stage = stages[0];
+        Stage& simulation_stage = stages[1];
+        Stage& upload_stage = stages[2];
+        Stage& render_stage = stages[3];
+        Stage& buoyancy_stage = stages[4];
+
+        const size_t total_frames {settings.warmup_frames + settings.frames};
+
+        if (window) {
+            Game::Renderer renderer(settings.width, settings.height);
+            shader_startup_ms = renderer.get_shader_startup_ms();
+            // one simulation step per frame, at state times that only depend on the frame index
+            renderer.get_clock().set_timestep(settings.timestep);
+            renderer.get_ocean()->rebuild(ocean_settings);
+            if (!settings.baked_file.empty()) renderer.get_ocean()->load_bake(settings.baked_file);
+
+            Game::ClipmapSettings clipmap_settings = renderer.get_clipmap()->get_settings();
+            clipmap_settings.grid_size = settings.grid_size;
+            renderer.get_clipmap()->rebuild(clipmap_settings);
+            renderer.get_buoyancy()->rebuild(buoyancy_settings);
+
+            for (size_t frame {0}; frame < total_frames; frame++) {
+                Time::Timer::delta_time = settings.timestep;
+                auto frame_start = Clock::now();
+
+                renderer.update(window, static_cast<float>(settings.timestep));
+
+                auto render_start = Clock::now();
+                renderer.render_scene();
+                glFinish();
+                double render_ms = elapsed_ms(render_start);
+
+                if (frame < settings.warmup_frames) continue;
+                Game::Ocean* ocean = renderer.get_ocean();
+                frame_stage.samples.push_back(elapsed_ms(frame_start));
+                simulation_stage.samples.push_back(ocean->get_simulation_ms());
+                upload_stage.samples.push_back(ocean->get_upload_ms());
+                render_stage.samples.push_back(render_ms - ocean->get_upload_ms());
+                buoyancy_stage.samples.push_back(renderer.get_buoyancy()->get_step_ms());
+            }
+        }
+        else {
+            Game::Ocean ocean(ocean_settings);
+            if (!settings.baked_file.empty()) ocean.load_bake(settings.baked_file);
+            Game::Buoyancy buoyancy(buoyancy_settings);
+
+            for (size_t frame {0}; frame < total_frames; frame++) {
+                auto frame_start = Clock::now();
+                const double time {static_cast<double>(frame + 1) * settings.timestep};
+                ocean.simulate(time);
+                buoyancy.step(ocean, time, static_cast<float>(settings.timestep));
+
+                if (frame < settings.warmup_frames) continue;
+                frame_stage.samples.push_back(elapsed_ms(frame_start));
+                simulation_stage.samples.push_back(ocean.get_simulation_ms());
+                buoyancy_stage.samples.push_back(buoyancy.get_step_ms());
+            }
+        }
+
+        write_results(stages);
+        return 0;
+    }
+
+    void Headless::write_results(const std::vector<Stage>& stages) {
+        std::ofstream file(settings.output_file);
+        if (!file.is_open()) {
+            out_error("failed to open {}", settings.output_file);
+            return;
+        }
+
+        const bool csv = std::filesystem::path(settings.output_file).extension() == ".csv";
+
+        if (csv) {
+            file << "stage,samples,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+            for (const Stage& stage : stages) {
+                if (stage.samples.empty()) continue;
+                file << std::format("{},{},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f}\n",
+                    stage.name, stage.samples.size(), mean(stage.samples),
+                    percentile(stage.samples, .5), percentile(stage.samples, .9),
+                    percentile(stage.samples, .99), percentile(stage.samples, 1.));
+            }
+        }
+        else {
+            file << "{\n";
+            file << std::format("  \"context\": \"{}\",\n", context_description);
+            file << std::format("  \"frames\": {},\n", settings.frames);
+            file << std::format("  \"timestep\": {},\n", settings.timestep);
+            file << std::format("  \"grid_size\": {},\n", settings.grid_size);
+            file << std::format("  \"spectrum_size\": {},\n", settings.spectrum_size);
+            file << std::format("  \"workers\": {},\n", Jobs::get_worker_count());
+            if (window) {
+                Shader::CacheStatistics cache = Shader::get_cache_statistics();
+                file << std::format("  \"shader_startup_ms\": {:.4f},\n", shader_startup_ms);
+                file << std::format("  \"shader_cache\": {{ \"hits\": {}, \"misses\": {} }},\n", cache.hits, cache.misses);
+            }
+            file << "  \"stages\": {";
+
+            bool first {true};
+            for (const Stage& stage : stages) {
+                if (stage.samples.empty()) continue;
+                file << std::format("{}\n    \"{}\": {{ \"mean_ms\": {:.4f}, \"p50_ms\": {:.4f}, \"p90_ms\": {:.4f}, \"p99_ms\": {:.4f}, \"max_ms\": {:.4f} }}",
+                    first ? "" : ",", stage.name, mean(stage.samples),
+                    percentile(stage.samples, .5), percentile(stage.samples, .9),
+                    percentile(stage.samples, .99), percentile(stage.samples, 1.));
+                first = false;
+            }
+
+            file << "\n  }\n}\n";
+        }
+
+        out("benchmark results written to {}", settings.output_file);
+    }
+}
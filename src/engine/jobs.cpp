@@ -0,0 +1,263 @@
+#include "jobs.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <utility>
+
+namespace Engine {
+    struct Jobs::Task {
+        std::function<void()> body;
+        // unfinished dependencies, plus one held by submit() until every dependency is registered
+        std::atomic<size_t> remaining {1};
+        std::atomic<bool> done {false};
+        std::mutex mutex;
+        std::vector<Handle> continuations;
+        // the task whose parallel_for queued this chunk, so waiting on that task may help with it
+        const Task* owner {nullptr};
+    };
+
+    namespace {
+        constexpr size_t EXTERNAL_QUEUE {SIZE_MAX};
+
+        // threads that are not workers share one injection queue
+        thread_local size_t queue_index {EXTERNAL_QUEUE};
+        thread_local const Jobs::Task* running_task {nullptr};
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Jobs::Handle> tasks;
+        };
+
+        struct Batch {
+            const std::function<void(size_t, size_t)>* body;
+            size_t count;
+            size_t chunk;
+            size_t chunks;
+            std::atomic<size_t> next {0};
+            std::atomic<size_t> pending {0};
+        };
+
+        class Pool {
+        public:
+            Pool() {
+                // at least one worker even on a single core: a waiter only runs its own task, so submitted jobs nobody
+                // waits on would otherwise never start
+                size_t worker_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+                for (size_t i {0}; i <= worker_count; i++) queues.push_back(std::make_unique<Queue>());
+                for (size_t i {0}; i < worker_count; i++)
+                    workers.emplace_back([this, i] { work(i); });
+            }
+
+            ~Pool() {
+                {
+                    std::lock_guard lock(sleep_mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for (auto& worker : workers) worker.join();
+            }
+
+            size_t get_worker_count() { return workers.size(); }
+
+            void schedule(Jobs::Handle task) {
+                Queue& queue = *queues[local_queue()];
+                {
+                    // counted under the queue's lock before it is visible, so a pop can never take `queued` below zero
+                    std::lock_guard lock(queue.mutex);
+                    queued++;
+                    queue.tasks.push_back(std::move(task));
+                }
+
+                std::lock_guard lock(sleep_mutex);
+                wake.notify_one();
+            }
+
+            // the own queue is popped lifo for locality, victims are robbed fifo so thieves take the oldest (largest) work
+            Jobs::Handle find() {
+                const size_t own = local_queue();
+                if (Jobs::Handle task = pop(*queues[own], true)) return task;
+
+                for (size_t offset {1}; offset < queues.size(); offset++) {
+                    if (Jobs::Handle task = pop(*queues[(own + offset) % queues.size()], false)) return task;
+                }
+                return nullptr;
+            }
+
+            // only the awaited task and the chunks of batches it started, so a waiting thread never picks up unrelated
+            // long work that would hold it past the point its own task finished
+            Jobs::Handle find_for(const Jobs::Task* awaited) {
+                for (auto& queue : queues) {
+                    std::lock_guard lock(queue->mutex);
+                    auto found = std::ranges::find_if(queue->tasks, [awaited](const Jobs::Handle& task) {
+                        return task.get() == awaited || task->owner == awaited;
+                    });
+                    if (found == queue->tasks.end()) continue;
+
+                    Jobs::Handle task = std::move(*found);
+                    queue->tasks.erase(found);
+                    queued--;
+                    return task;
+                }
+                return nullptr;
+            }
+
+            void run(const Jobs::Handle& task) {
+                const Jobs::Task* outer = std::exchange(running_task, task.get());
+                task->body();
+                task->body = nullptr;
+                running_task = outer;
+
+                std::vector<Jobs::Handle> continuations;
+                {
+                    std::lock_guard lock(task->mutex);
+                    task->done = true;
+                    continuations.swap(task->continuations);
+                }
+                task->done.notify_all();
+
+                for (Jobs::Handle& continuation : continuations)
+                    if (--continuation->remaining == 0) schedule(std::move(continuation));
+            }
+
+            void run_batch(const std::shared_ptr<Batch>& batch) {
+                size_t finished {0};
+                for (size_t index = batch->next++; index < batch->chunks; index = batch->next++) {
+                    size_t begin = index * batch->chunk;
+                    (*batch->body)(begin, std::min(begin + batch->chunk, batch->count));
+                    finished++;
+                }
+
+                if (finished > 0 && batch->pending.fetch_sub(finished) == finished) batch->pending.notify_all();
+            }
+
+        private:
+            size_t local_queue() {
+                return queue_index == EXTERNAL_QUEUE ? workers.size() : queue_index;
+            }
+
+            Jobs::Handle pop(Queue& queue, bool back) {
+                std::lock_guard lock(queue.mutex);
+                if (queue.tasks.empty()) return nullptr;
+
+                Jobs::Handle task;
+                if (back) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                queued--;
+                return task;
+            }
+
+            void work(size_t index) {
+                queue_index = index;
+
+                while (true) {
+                    if (Jobs::Handle task = find()) {
+                        run(task);
+                        continue;
+                    }
+
+                    std::unique_lock lock(sleep_mutex);
+                    wake.wait(lock, [&] { return stopping || queued > 0; });
+                    if (stopping) return;
+                }
+            }
+
+            std::vector<std::thread> workers;
+            std::vector<std::unique_ptr<Queue>> queues;
+            std::atomic<size_t> queued {0};
+            std::mutex sleep_mutex;
+            std::condition_variable wake;
+            bool stopping {false};
+        };
+
+        Pool& get_pool() {
+            static Pool pool;
+            return pool;
+        }
+    }
+
+    size_t Jobs::get_worker_count() {
+        return get_pool().get_worker_count();
+    }
+
+    void Jobs::parallel_for(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body) {
+        if (count == 0) return;
+        grain = std::max<size_t>(grain, 1);
+
+        Pool& pool = get_pool();
+        size_t threads = pool.get_worker_count() + 1;
+        size_t chunk = std::max(grain, (count + threads * 4 - 1) / (threads * 4));
+
+        if (threads == 1 || chunk >= count) {
+            body(0, count);
+            return;
+        }
+
+        auto batch = std::make_shared<Batch>();
+        batch->body = &body;
+        batch->count = count;
+        batch->chunk = chunk;
+        batch->chunks = (count + chunk - 1) / chunk;
+        batch->pending = batch->chunks;
+
+        // helpers only claim chunk indices, so one that is stolen after the batch has finished never touches `body`
+        const size_t helpers = std::min(batch->chunks, threads) - 1;
+        for (size_t i {0}; i < helpers; i++) {
+            auto task = std::make_shared<Task>();
+            task->body = [&pool, batch] { pool.run_batch(batch); };
+            task->remaining = 0;
+            task->owner = running_task;
+            pool.schedule(std::move(task));
+        }
+
+        pool.run_batch(batch);
+
+        // every chunk is claimed by now, the rest are already running elsewhere
+        for (size_t pending = batch->pending; pending != 0; pending = batch->pending)
+            batch->pending.wait(pending);
+    }
+
+    Jobs::Handle Jobs::submit(std::function<void()> body, std::initializer_list<Handle> dependencies) {
+        auto task = std::make_shared<Task>();
+        task->body = std::move(body);
+
+        for (const Handle& dependency : dependencies) {
+            if (!dependency) continue;
+            std::lock_guard lock(dependency->mutex);
+            if (dependency->done) continue;
+            task->remaining++;
+            dependency->continuations.push_back(task);
+        }
+
+        if (--task->remaining == 0) get_pool().schedule(task);
+        return task;
+    }
+
+    bool Jobs::is_done(const Handle& handle) {
+        return !handle || handle->done;
+    }
+
+    void Jobs::wait(const Handle& handle) {
+        if (!handle) return;
+        Pool& pool = get_pool();
+
+        while (!handle->done) {
+            if (Handle task = pool.find_for(handle.get())) {
+                pool.run(task);
+                continue;
+            }
+            // whatever is left is running on other threads and ends by notifying `done`
+            handle->done.wait(false);
+        }
+    }
+}
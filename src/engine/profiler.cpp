@@ -0,0 +1,323 @@
+#include "profiler.h"
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <glad/glad.h>
+#include <imgui.h>
+#include <implot.h>
+#include "utils.h"
+
+namespace Engine {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        constexpr size_t MAX_TRACE_EVENTS {1 << 16};
+
+        struct History {
+            std::array<float, Profiler::HISTORY_SIZE> samples {};
+            size_t count {0};
+
+            void push(float sample) {
+                samples[count % Profiler::HISTORY_SIZE] = sample;
+                count++;
+            }
+
+            size_t size() const { return std::min(count, Profiler::HISTORY_SIZE); }
+        };
+
+        struct Stage {
+            std::string name;
+            double cpu_frame_ms {0.};
+            bool hit {false};
+            History cpu;
+            History gpu;
+        };
+
+        struct QueryPair {
+            size_t stage;
+            GLuint begin;
+            GLuint end;
+        };
+
+        struct QueryFrame {
+            std::vector<GLuint> pool;
+            std::vector<QueryPair> pairs;
+            int64_t cpu_origin_us {0};
+            GLint64 gpu_origin_ns {0};
+        };
+
+        struct TraceEvent {
+            size_t stage;
+            bool gpu;
+            uint32_t thread;
+            int64_t start_us;
+            int64_t duration_us;
+        };
+
+        struct State {
+            std::mutex mutex;
+            std::vector<Stage> stages;
+            std::unordered_map<std::string, size_t> lookup;
+            std::array<QueryFrame, Profiler::QUERY_FRAMES> query_frames;
+            std::deque<TraceEvent> events;
+            size_t frame_index {0};
+            bool gpu_enabled {false};
+            std::thread::id gl_thread {std::this_thread::get_id()};
+            Clock::time_point epoch {Clock::now()};
+            Clock::time_point frame_start {Clock::now()};
+        };
+
+        State& get_state() {
+            static State state;
+            return state;
+        }
+
+        int64_t to_us(Clock::time_point time) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(time - get_state().epoch).count();
+        }
+
+        uint32_t thread_index() {
+            static std::atomic<uint32_t> next {1};
+            thread_local uint32_t index {next++};
+            return index;
+        }
+
+        size_t find_stage(State& state, std::string_view name) {
+            auto it = state.lookup.find(std::string(name));
+            if (it != state.lookup.end()) return it->second;
+
+            state.stages.push_back(Stage {std::string(name)});
+            state.lookup.emplace(std::string(name), state.stages.size() - 1);
+            return state.stages.size() - 1;
+        }
+
+        void push_event(State& state, TraceEvent event) {
+            state.events.push_back(event);
+            if (state.events.size() > MAX_TRACE_EVENTS) state.events.pop_front();
+        }
+
+        Profiler::Statistics compute_statistics(const History& history) {
+            Profiler::Statistics statistics;
+            const size_t size = history.size();
+            if (size == 0) return statistics;
+
+            std::vector<float> sorted(history.samples.begin(), history.samples.begin() + size);
+            std::sort(sorted.begin(), sorted.end());
+
+            double sum {0.};
+            for (float sample : sorted) sum += sample;
+
+            statistics.min = sorted.front();
+            statistics.average = static_cast<float>(sum / size);
+            statistics.p99 = sorted[std::min(size - 1, static_cast<size_t>(std::ceil(.99 * size)) - 1)];
+            statistics.last = history.samples[(history.count - 1) % Profiler::HISTORY_SIZE];
+            return statistics;
+        }
+
+        // only ever reads a slot that was submitted QUERY_FRAMES frames ago, and drops it rather than waiting if it is still in flight
+        void resolve_queries(State& state, QueryFrame& frame) {
+            if (frame.pairs.empty()) return;
+
+            GLint available {0};
+            glGetQueryObjectiv(frame.pairs.back().end, GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available) {
+                std::vector<double> gpu_frame_ms(state.stages.size(), 0.);
+                std::vector<bool> gpu_hit(state.stages.size(), false);
+
+                for (const QueryPair& pair : frame.pairs) {
+                    GLuint64 begin {0}, end {0};
+                    glGetQueryObjectui64v(pair.begin, GL_QUERY_RESULT, &begin);
+                    glGetQueryObjectui64v(pair.end, GL_QUERY_RESULT, &end);
+
+                    const int64_t duration_ns = static_cast<int64_t>(end - begin);
+                    gpu_frame_ms[pair.stage] += duration_ns * 1e-6;
+                    gpu_hit[pair.stage] = true;
+
+                    push_event(state, TraceEvent {
+                        .stage = pair.stage,
+                        .gpu = true,
+                        .thread = 0,
+                        .start_us = frame.cpu_origin_us + (static_cast<int64_t>(begin) - frame.gpu_origin_ns) / 1000,
+                        .duration_us = duration_ns / 1000
+                    });
+                }
+
+                for (size_t stage {0}; stage < state.stages.size(); stage++)
+                    if (gpu_hit[stage]) state.stages[stage].gpu.push(static_cast<float>(gpu_frame_ms[stage]));
+            }
+
+            frame.pairs.clear();
+        }
+    }
+
+    Profiler::Scope::Scope(std::string_view name, bool gpu) {
+        State& state = get_state();
+        {
+            std::lock_guard lock(state.mutex);
+            stage = find_stage(state, name);
+
+            if (gpu && state.gpu_enabled && std::this_thread::get_id() == state.gl_thread) {
+                QueryFrame& frame = state.query_frames[state.frame_index % QUERY_FRAMES];
+                const size_t needed = (frame.pairs.size() + 1) * 2;
+                if (frame.pool.size() < needed) {
+                    const size_t first = frame.pool.size();
+                    frame.pool.resize(needed);
+                    glGenQueries(static_cast<GLsizei>(needed - first), frame.pool.data() + first);
+                }
+
+                query = frame.pairs.size();
+                frame.pairs.push_back(QueryPair {stage, frame.pool[query * 2], frame.pool[query * 2 + 1]});
+                glQueryCounter(frame.pairs.back().begin, GL_TIMESTAMP);
+            }
+        }
+        start = Clock::now();
+    }
+
+    Profiler::Scope::~Scope() {
+        auto end = Clock::now();
+        State& state = get_state();
+        std::lock_guard lock(state.mutex);
+
+        if (query != SIZE_MAX) {
+            QueryFrame& frame = state.query_frames[state.frame_index % QUERY_FRAMES];
+            if (query < frame.pairs.size()) glQueryCounter(frame.pairs[query].end, GL_TIMESTAMP);
+        }
+
+        Stage& current = state.stages[stage];
+        current.cpu_frame_ms += std::chrono::duration<double, std::milli>(end - start).count();
+        current.hit = true;
+
+        push_event(state, TraceEvent {
+            .stage = stage,
+            .gpu = false,
+            .thread = thread_index(),
+            .start_us = to_us(start),
+            .duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+        });
+    }
+
+    void Profiler::set_gpu_enabled(bool enabled) {
+        State& state = get_state();
+        std::lock_guard lock(state.mutex);
+        state.gpu_enabled = enabled;
+        state.gl_thread = std::this_thread::get_id();
+    }
+
+    void Profiler::new_frame() {
+        State& state = get_state();
+        std::lock_guard lock(state.mutex);
+
+        auto now = Clock::now();
+        const size_t frame_stage = find_stage(state, "frame");
+        state.stages[frame_stage].cpu_frame_ms = std::chrono::duration<double, std::milli>(now - state.frame_start).count();
+        state.stages[frame_stage].hit = true;
+        state.frame_start = now;
+
+        for (Stage& stage : state.stages) {
+            if (stage.hit) stage.cpu.push(static_cast<float>(stage.cpu_frame_ms));
+            stage.cpu_frame_ms = 0.;
+            stage.hit = false;
+        }
+
+        state.frame_index++;
+        QueryFrame& frame = state.query_frames[state.frame_index % QUERY_FRAMES];
+
+        if (state.gpu_enabled) {
+            resolve_queries(state, frame);
+            frame.cpu_origin_us = to_us(now);
+            glGetInteger64v(GL_TIMESTAMP, &frame.gpu_origin_ns);
+        }
+    }
+
+    Profiler::Statistics Profiler::get_cpu_statistics(std::string_view name) {
+        State& state = get_state();
+        std::lock_guard lock(state.mutex);
+        auto it = state.lookup.find(std::string(name));
+        return it == state.lookup.end() ? Statistics {} : compute_statistics(state.stages[it->second].cpu);
+    }
+
+    Profiler::Statistics Profiler::get_gpu_statistics(std::string_view name) {
+        State& state = get_state();
+        std::lock_guard lock(state.mutex);
+        auto it = state.lookup.find(std::string(name));
+        return it == state.lookup.end() ? Statistics {} : compute_statistics(state.stages[it->second].gpu);
+    }
+
+    void Profiler::draw_imgui() {
+        State& state = get_state();
+        std::unique_lock lock(state.mutex);
+
+        if (ImGui::BeginTable("profiler-stages", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("stage");
+            ImGui::TableSetupColumn("cpu-min");
+            ImGui::TableSetupColumn("cpu-avg");
+            ImGui::TableSetupColumn("cpu-p99");
+            ImGui::TableSetupColumn("gpu-min");
+            ImGui::TableSetupColumn("gpu-avg");
+            ImGui::TableSetupColumn("gpu-p99");
+            ImGui::TableHeadersRow();
+
+            for (const Stage& stage : state.stages) {
+                Statistics cpu = compute_statistics(stage.cpu);
+                Statistics gpu = compute_statistics(stage.gpu);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text(stage.name.c_str());
+                for (float value : {cpu.min, cpu.average, cpu.p99, gpu.min, gpu.average, gpu.p99}) {
+                    ImGui::TableNextColumn();
+                    ImGui::Text(std::format("{:.3f}", value).c_str());
+                }
+            }
+            ImGui::EndTable();
+        }
+
+        if (ImPlot::BeginPlot("profiler-timeline", ImVec2(-1, 220))) {
+            ImPlot::SetupAxes("frame", "ms", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+            for (const Stage& stage : state.stages) {
+                for (const auto& [history, suffix] : {std::pair {&stage.cpu, " (cpu)"}, std::pair {&stage.gpu, " (gpu)"}}) {
+                    if (history->size() == 0) continue;
+                    const int offset = static_cast<int>(history->count >= HISTORY_SIZE ? history->count % HISTORY_SIZE : 0);
+                    ImPlot::PlotLine((stage.name + suffix).c_str(), history->samples.data(), static_cast<int>(history->size()), 1., 0., 0, offset);
+                }
+            }
+            ImPlot::EndPlot();
+        }
+
+        lock.unlock();
+        if (ImGui::Button("export chrome trace")) {
+            std::filesystem::path path = std::filesystem::current_path() / "trace.json";
+            if (export_chrome_trace(path)) out("chrome trace written to {}", path.string());
+        }
+    }
+
+    bool Profiler::export_chrome_trace(const std::filesystem::path& path) {
+        State& state = get_state();
+        std::lock_guard lock(state.mutex);
+
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            out_error("failed to open {}", path.string());
+            return false;
+        }
+
+        file << "{\"traceEvents\":[\n";
+        file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"cpu\"}},\n";
+        file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"gpu\"}}";
+
+        for (const TraceEvent& event : state.events) {
+            file << std::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":{},\"tid\":{},\"ts\":{},\"dur\":{}}}",
+                state.stages[event.stage].name, event.gpu ? 2 : 1, event.thread, event.start_us, event.duration_us);
+        }
+
+        file << "\n]}\n";
+        return true;
+    }
+}
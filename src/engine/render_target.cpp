@@ -0,0 +1,75 @@
+#include "render_target.h"
+#include <algorithm>
+
+namespace Engine {
+    namespace {
+        size_t bytes_per_pixel(GLenum format) {
+            switch (format) {
+                case GL_R8: return 1;
+                case GL_R16F: case GL_RG8: return 2;
+                case GL_RG16F: case GL_R32F: return 4;
+                case GL_RGBA16F: case GL_RG32F: return 8;
+                case GL_RGBA32F: return 16;
+                // rgb8, rgba8, depth24 and depth24-stencil8 are stored in four bytes by every driver we run on
+                default: return 4;
+            }
+        }
+    }
+
+    glm::uvec2 RenderTargetPool::bucket_size(glm::uvec2 size) {
+        size = glm::max(size, glm::uvec2(1));
+        return (size + BUCKET_GRANULARITY - 1u) / BUCKET_GRANULARITY * BUCKET_GRANULARITY;
+    }
+
+    size_t RenderTargetPool::get_bytes(const Description& description) {
+        return static_cast<size_t>(description.size.x) * description.size.y * bytes_per_pixel(description.format);
+    }
+
+    Texture* RenderTargetPool::acquire(const Description& description) {
+        const glm::uvec2 size = description.bucketed ? bucket_size(description.size) : glm::max(description.size, glm::uvec2(1));
+
+        for (Entry& entry : entries) {
+            const Description& candidate = entry.description;
+            if (entry.in_use || candidate.format != description.format || candidate.size != size) continue;
+            if (candidate.filter != description.filter || candidate.wrap != description.wrap || candidate.bucketed != description.bucketed) continue;
+
+            entry.in_use = true;
+            return entry.texture.get();
+        }
+
+        Texture::TextureCreateInfo create_info {GL_TEXTURE_2D};
+        create_info.width = size.x;
+        create_info.height = size.y;
+        create_info.format = description.format;
+        create_info.filter = description.filter;
+        create_info.wrap = description.wrap;
+
+        Description bucketed {description};
+        bucketed.size = size;
+        entries.push_back(Entry {std::make_unique<Texture>(create_info), bucketed, true, 0});
+        allocation_count++;
+        return entries.back().texture.get();
+    }
+
+    void RenderTargetPool::release(Texture* texture) {
+        for (Entry& entry : entries) {
+            if (entry.texture.get() != texture) continue;
+            entry.in_use = false;
+            entry.released_frame = frame;
+            return;
+        }
+    }
+
+    void RenderTargetPool::new_frame() {
+        frame++;
+        std::erase_if(entries, [this](const Entry& entry) {
+            return !entry.in_use && frame - entry.released_frame > RETIRE_FRAMES;
+        });
+    }
+
+    size_t RenderTargetPool::get_allocated_bytes() {
+        size_t bytes {0};
+        for (const Entry& entry : entries) bytes += get_bytes(entry.description);
+        return bytes;
+    }
+}
@@ -1,83 +1,465 @@
 #include "shader.h"
+#include <algorithm>
 
 namespace Engine {
-    void check_status(unsigned int shader, GLenum pname) {
+    GLbitfield Shader::pending_barriers {0};
+
+    constexpr GLbitfield BUFFER_WRITE_BARRIERS {
+        GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT |
+        GL_UNIFORM_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT
+    };
+
+    constexpr GLbitfield IMAGE_WRITE_BARRIERS {
+        GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT |
+        GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT
+    };
+
+    Shader::CacheStatistics Shader::cache_statistics {};
+    std::filesystem::path Shader::cache_directory {"shader_cache"};
+
+    namespace {
+        constexpr uint32_t CACHE_MAGIC {0x4f435342};
+
+        struct CacheHeader {
+            uint32_t magic;
+            GLenum format;
+            uint64_t key;
+            uint64_t length;
+        };
+
+        uint64_t hash_text(uint64_t hash, std::string_view text) {
+            for (unsigned char c : text) {
+                hash ^= c;
+                hash *= 0x100000001b3ull;
+            }
+            // separator, so ("ab", "c") and ("a", "bc") differ
+            hash ^= 0xff;
+            hash *= 0x100000001b3ull;
+            return hash;
+        }
+
+        // a binary is only valid for the exact driver that produced it
+        uint64_t program_key(const std::vector<std::string_view>& sources) {
+            uint64_t hash {0xcbf29ce484222325ull};
+            for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+                const GLubyte* value = glGetString(name);
+                hash = hash_text(hash, value ? reinterpret_cast<const char*>(value) : "");
+            }
+            for (std::string_view source : sources) hash = hash_text(hash, source);
+            return hash;
+        }
+
+        bool binary_cache_supported() {
+            static const bool supported = [] {
+                GLint formats {0};
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+                return formats > 0;
+            }();
+            return supported;
+        }
+
+        bool parallel_compile_supported() {
+#ifdef GL_KHR_parallel_shader_compile
+            static const bool supported = [] {
+                if (!GLAD_GL_KHR_parallel_shader_compile) return false;
+                glMaxShaderCompilerThreadsKHR(0xffffffff);
+                return true;
+            }();
+            return supported;
+#else
+            return false;
+#endif
+        }
+
+        std::filesystem::path cache_file(const std::filesystem::path& directory, uint64_t key) {
+            return directory / std::format("{:016x}.bin", key);
+        }
+
+        bool load_binary(GLuint program, const std::filesystem::path& directory, uint64_t key) {
+            if (!binary_cache_supported()) return false;
+
+            std::ifstream file(cache_file(directory, key), std::ios::binary);
+            if (!file.is_open()) return false;
+
+            CacheHeader header;
+            if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != CACHE_MAGIC || header.key != key) return false;
+
+            std::vector<char> binary(header.length);
+            if (!file.read(binary.data(), binary.size())) return false;
+
+            glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+            // a driver update silently invalidates binaries, which then fail to link and are rebuilt from source
+            GLint success {0};
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            return success;
+        }
+
+        void store_binary(GLuint program, const std::filesystem::path& directory, uint64_t key) {
+            if (!binary_cache_supported()) return;
+
+            GLint length {0};
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length <= 0) return;
+
+            CacheHeader header {CACHE_MAGIC, 0, key, static_cast<uint64_t>(length)};
+            std::vector<char> binary(length);
+            glGetProgramBinary(program, length, nullptr, &header.format, binary.data());
+
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            std::ofstream file(cache_file(directory, key), std::ios::binary);
+            if (!file.is_open()) {
+                out_warn("failed to write shader cache entry {}", cache_file(directory, key).string());
+                return;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(), binary.size());
+        }
+    }
+
+    std::string shader_info_log(unsigned int shader) {
+        GLint length {0};
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(std::max(length, 1), '\0');
+        glGetShaderInfoLog(shader, length, nullptr, log.data());
+        log.resize(std::max(length - 1, 0));
+        return log;
+    }
+
+    std::string program_info_log(unsigned int program) {
+        GLint length {0};
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string log(std::max(length, 1), '\0');
+        glGetProgramInfoLog(program, length, nullptr, log.data());
+        log.resize(std::max(length - 1, 0));
+        return log;
+    }
+
+    void Shader::build(const std::vector<Stage>& stages) {
+        dependencies.clear();
+        std::vector<std::string_view> sources;
+        bool preprocessed {true};
+        for (const Stage& stage : stages) {
+            sources.push_back(stage.source.source);
+            preprocessed &= stage.source.success;
+            for (const std::filesystem::path& file : stage.source.files)
+                if (std::find(dependencies.begin(), dependencies.end(), file) == dependencies.end()) dependencies.push_back(file);
+        }
+        if (!preprocessed) return;
+
+        const uint64_t key = program_key(sources);
+
+        id = glCreateProgram();
+        if (load_binary(id, cache_directory, key)) {
+            cache_statistics.hits++;
+            reflect();
+            return;
+        }
+
+        // a rejected binary may leave the program in an error state, start over with a fresh object
+        glDeleteProgram(id);
+        id = glCreateProgram();
+        cache_statistics.misses++;
+        cache_key = key;
+
+        glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        for (const Stage& stage : stages) {
+            const char* source_data = stage.source.source.data();
+            const GLint source_length = static_cast<GLint>(stage.source.source.size());
+
+            unsigned int shader = glCreateShader(stage.type);
+            glShaderSource(shader, 1, &source_data, &source_length);
+            glCompileShader(shader);
+            glAttachShader(id, shader);
+            pending_stages.push_back(PendingStage {shader, stage.source.files});
+        }
+        glLinkProgram(id);
+
+        // with parallel compilation the driver keeps working until the program is first needed, see finish()
+        if (!parallel_compile_supported()) finish();
+    }
+
+    void Shader::finish() {
+        if (pending_stages.empty()) return;
+
         int success;
-        glGetShaderiv(shader, pname, &success);
+        glGetProgramiv(id, GL_LINK_STATUS, &success);
         if (!success) {
-            char info_log[512];
-            glGetShaderInfoLog(shader, 512, NULL, info_log);
-            std::cout << "ERROR::SHADER::COMPILATION_FAILED\n" << info_log << std::endl;
+            for (const PendingStage& stage : pending_stages) {
+                int compiled;
+                glGetShaderiv(stage.id, GL_COMPILE_STATUS, &compiled);
+                if (!compiled) out_error("failed to compile {}\n{}", stage.files.front().string(), ShaderPreprocessor::annotate_log(shader_info_log(stage.id), stage.files));
+            }
+            out_error("failed to link program ({})\n{}", dependencies.front().string(), program_info_log(id));
         }
+        else store_binary(id, cache_directory, cache_key);
+
+        for (const PendingStage& stage : pending_stages) glDeleteShader(stage.id);
+        pending_stages.clear();
+        reflect();
+    }
+
+    bool Shader::is_ready() {
+        if (pending_stages.empty()) return true;
+#ifdef GL_KHR_parallel_shader_compile
+        if (parallel_compile_supported()) {
+            GLint complete {0};
+            glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &complete);
+            if (!complete) return false;
+        }
+#endif
+        finish();
+        return true;
     }
 
     void Shader::load(std::string_view vertex_shader_file, std::string_view fragment_shader_file) {
-        std::string vertex_shader_source_str, fragment_shader_source_str;
-        Utils::read_file_content(vertex_shader_file, vertex_shader_source_str);
-        Utils::read_file_content(fragment_shader_file, fragment_shader_source_str);
-        
-        const char* vertex_shader_source = vertex_shader_source_str.c_str();
-        const char* fragment_shader_source = fragment_shader_source_str.c_str();
-
-        unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex_shader, 1, &vertex_shader_source, 0);
-        glCompileShader(vertex_shader);
-        check_status(vertex_shader, GL_COMPILE_STATUS);
-
-        unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment_shader, 1, &fragment_shader_source, 0);
-        glCompileShader(fragment_shader);
-        check_status(fragment_shader, GL_COMPILE_STATUS);
+        build({
+            {GL_VERTEX_SHADER, ShaderPreprocessor::process(vertex_shader_file, defines)},
+            {GL_FRAGMENT_SHADER, ShaderPreprocessor::process(fragment_shader_file, defines)}
+        });
+    }
 
-        id = glCreateProgram();
-        glAttachShader(id, vertex_shader);
-        glAttachShader(id, fragment_shader);
-        glLinkProgram(id);
-        check_status(id, GL_LINK_STATUS);
+    void Shader::load(std::string_view compute_shader_file) {
+        if (!GLAD_GL_VERSION_4_3) {
+            out_error("compute shaders need opengl 4.3 ({})", Utils::get_file_name(compute_shader_file));
+            return;
+        }
+
+        build({{GL_COMPUTE_SHADER, ShaderPreprocessor::process(compute_shader_file, defines)}});
+    }
+
+    void Shader::reflect() {
+        reflection = {};
+
+        int success;
+        glGetProgramiv(id, GL_LINK_STATUS, &success);
+        linked = success;
+        if (!success) return;
+
+        if (type == ShaderType::Compute) {
+            int size[3];
+            glGetProgramiv(id, GL_COMPUTE_WORK_GROUP_SIZE, size);
+            workgroup_size = glm::uvec3(size[0], size[1], size[2]);
+        }
 
-        glDeleteShader(fragment_shader);
-        glDeleteShader(vertex_shader);
+        auto resource_name = [this](GLenum interface, GLuint index) {
+            GLint length {0};
+            const GLenum property {GL_NAME_LENGTH};
+            glGetProgramResourceiv(id, interface, index, 1, &property, 1, nullptr, &length);
+            std::string name(std::max(length, 1), '\0');
+            glGetProgramResourceName(id, interface, index, length, nullptr, name.data());
+            name.resize(std::max(length - 1, 0));
+            return name;
+        };
+
+        GLint count {0};
+        glGetProgramInterfaceiv(id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i {0}; i < count; i++) {
+            const GLenum properties[] {GL_BLOCK_INDEX, GL_LOCATION};
+            GLint values[2];
+            glGetProgramResourceiv(id, GL_UNIFORM, i, 2, properties, 2, nullptr, values);
+            if (values[0] != -1) continue;
+
+            // arrays are reported as "name[0]", setters address them by their plain name
+            std::string name = resource_name(GL_UNIFORM, i);
+            if (name.ends_with("[0]")) name.resize(name.size() - 3);
+            reflection.uniforms.emplace(std::move(name), values[1]);
+        }
+
+        glGetProgramInterfaceiv(id, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i {0}; i < count; i++) {
+            std::string name = resource_name(GL_UNIFORM_BLOCK, i);
+            if (name == FRAME_BLOCK_NAME) glUniformBlockBinding(id, i, FRAME_BLOCK_BINDING);
+
+            const GLenum property {GL_BUFFER_BINDING};
+            GLint binding {0};
+            glGetProgramResourceiv(id, GL_UNIFORM_BLOCK, i, 1, &property, 1, nullptr, &binding);
+            reflection.uniform_blocks.emplace(std::move(name), binding);
+        }
+
+        glGetProgramInterfaceiv(id, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i {0}; i < count; i++) {
+            const GLenum property {GL_BUFFER_BINDING};
+            GLint binding {0};
+            glGetProgramResourceiv(id, GL_SHADER_STORAGE_BLOCK, i, 1, &property, 1, nullptr, &binding);
+            reflection.storage_blocks.emplace(resource_name(GL_SHADER_STORAGE_BLOCK, i), binding);
+        }
     }
 
-    Shader::Shader(std::string_view vertex_shader_file, std::string_view fragment_shader_file) : vert_file(vertex_shader_file), frag_file(fragment_shader_file) {
+    GLint Shader::get_uniform_location(std::string_view name) {
+        finish();
+        auto it = reflection.uniforms.find(name);
+        return it == reflection.uniforms.end() ? -1 : it->second;
+    }
+
+    Shader::Shader(std::string_view vertex_shader_file, std::string_view fragment_shader_file, const ShaderDefines& defines) : vert_file(vertex_shader_file), frag_file(fragment_shader_file), defines(defines) {
         load(vertex_shader_file, fragment_shader_file);
     }
 
+    Shader::Shader(std::string_view compute_shader_file, const ShaderDefines& defines) : type(ShaderType::Compute), comp_file(compute_shader_file), defines(defines) {
+        load(compute_shader_file);
+    }
+
+    Shader::Shader(Shader&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    Shader& Shader::operator=(Shader&& other) noexcept {
+        if (this == &other) return *this;
+        for (const PendingStage& stage : pending_stages) glDeleteShader(stage.id);
+        if (id) glDeleteProgram(id);
+
+        id = std::exchange(other.id, 0);
+        type = other.type;
+        vert_file = other.vert_file;
+        frag_file = other.frag_file;
+        comp_file = other.comp_file;
+        workgroup_size = other.workgroup_size;
+        written_barriers = other.written_barriers;
+        reflection = std::move(other.reflection);
+        pending_stages = std::exchange(other.pending_stages, {});
+        cache_key = other.cache_key;
+        defines = std::move(other.defines);
+        dependencies = std::move(other.dependencies);
+        linked = std::exchange(other.linked, false);
+        return *this;
+    }
+
     Shader::~Shader() {
-        glDeleteShader(id);
+        for (const PendingStage& stage : pending_stages) glDeleteShader(stage.id);
+        if (id) glDeleteProgram(id);
+    }
+
+    Shader Shader::recompile() const {
+        switch (type) {
+            case ShaderType::Compute: return Shader(comp_file, defines);
+            default: return Shader(vert_file, frag_file, defines);
+        }
+    }
+
+    bool Shader::reload() {
+        Shader candidate = recompile();
+        candidate.finish();
+        if (!candidate.linked) {
+            out_error("keeping the previous program, the rebuilt one did not link");
+            return false;
+        }
+
+        *this = std::move(candidate);
+        return true;
     }
 
-    void Shader::reload() {
-        glDeleteShader(id);
-        load(vert_file, frag_file);
+    bool Shader::is_linked() {
+        finish();
+        return linked;
     }
 
     void Shader::use() {
+        finish();
+        memory_barrier();
         glUseProgram(id);
     }
 
     void Shader::unuse() {
         glUseProgram(0);
     }
-    
-    Shader& Shader::set_uniform_float(std::string_view name, float value) 
+
+    void Shader::memory_barrier(GLbitfield consumers) {
+        GLbitfield barriers = pending_barriers & consumers;
+        if (!barriers) return;
+        glMemoryBarrier(barriers);
+        pending_barriers &= ~barriers;
+    }
+
+    Shader& Shader::set_uniform_float(std::string_view name, float value)
     {
-        int location = glGetUniformLocation(id, name.data());
+        int location = get_uniform_location(name);
         glProgramUniform1f(id, location, value);
         return *this;
     }
 
     Shader& Shader::set_uniform_mat4(std::string_view name, glm::mat4 matrix)
     {
-        int location = glGetUniformLocation(id, name.data());
+        int location = get_uniform_location(name);
         glProgramUniformMatrix4fv(id, location, 1, GL_FALSE, glm::value_ptr(matrix));
         return *this;
     }
 
-    Shader& Shader::set_uniform_vec3(std::string_view name, glm::vec3 vector) 
+    Shader& Shader::set_uniform_vec2(std::string_view name, glm::vec2 vector)
+    {
+        int location = get_uniform_location(name);
+        glProgramUniform2fv(id, location, 1, &vector[0]);
+        return *this;
+    }
+
+    Shader& Shader::set_uniform_vec3(std::string_view name, glm::vec3 vector)
     {
-        int location = glGetUniformLocation(id, name.data());
+        int location = get_uniform_location(name);
         glProgramUniform3fv(id, location, 1, &vector[0]);
         return *this;
     }
+
+    Shader& Shader::set_uniform_int(std::string_view name, int value)
+    {
+        int location = get_uniform_location(name);
+        glProgramUniform1i(id, location, value);
+        return *this;
+    }
+
+    Shader& Shader::set_uniform_floats(std::string_view name, std::span<const float> values)
+    {
+        int location = get_uniform_location(name);
+        glProgramUniform1fv(id, location, static_cast<GLsizei>(values.size()), values.data());
+        return *this;
+    }
+
+    Shader& Shader::set_uniform_ints(std::string_view name, std::span<const int> values)
+    {
+        int location = get_uniform_location(name);
+        glProgramUniform1iv(id, location, static_cast<GLsizei>(values.size()), values.data());
+        return *this;
+    }
+
+    Shader& Shader::bind_storage_buffer(GLuint binding, GL_Object& buffer, GLenum access)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer.get_id());
+        if (access != GL_READ_ONLY) written_barriers |= BUFFER_WRITE_BARRIERS;
+        return *this;
+    }
+
+    Shader& Shader::bind_image(GLuint unit, Texture& texture, GLenum access, GLenum format)
+    {
+        const GLboolean layered = texture.get_target() == GL_TEXTURE_2D_ARRAY ? GL_TRUE : GL_FALSE;
+        glBindImageTexture(unit, texture.get_id(), 0, layered, 0, access, format);
+        if (access != GL_READ_ONLY) written_barriers |= IMAGE_WRITE_BARRIERS;
+        return *this;
+    }
+
+    Shader& Shader::dispatch(GLuint groups_x, GLuint groups_y, GLuint groups_z)
+    {
+        use();
+        glDispatchCompute(groups_x, groups_y, groups_z);
+        pending_barriers |= std::exchange(written_barriers, 0);
+        return *this;
+    }
+
+    Shader& Shader::dispatch_threads(GLuint threads_x, GLuint threads_y, GLuint threads_z)
+    {
+        glm::uvec3 size = glm::max(workgroup_size, glm::uvec3(1));
+        return dispatch(
+            (threads_x + size.x - 1) / size.x,
+            (threads_y + size.y - 1) / size.y,
+            (threads_z + size.z - 1) / size.z
+        );
+    }
+
+    Shader& Shader::dispatch_indirect(Buffer& buffer, GLintptr offset)
+    {
+        use();
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer.get_id());
+        glDispatchComputeIndirect(offset);
+        pending_barriers |= std::exchange(written_barriers, 0);
+        return *this;
+    }
 }
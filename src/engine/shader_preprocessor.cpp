@@ -0,0 +1,106 @@
+#include "shader_preprocessor.h"
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include "utils.h"
+
+namespace Engine {
+    namespace {
+        constexpr size_t MAX_INCLUDE_DEPTH {32};
+
+        std::string_view trim(std::string_view text) {
+            const size_t begin = text.find_first_not_of(" \t\r");
+            if (begin == std::string_view::npos) return {};
+            const size_t end = text.find_last_not_of(" \t\r");
+            return text.substr(begin, end - begin + 1);
+        }
+
+        // matches "#directive" as well as "#  directive"
+        bool parse_directive(std::string_view line, std::string_view directive, std::string_view& argument) {
+            line = trim(line);
+            if (!line.starts_with('#')) return false;
+            line = trim(line.substr(1));
+            if (!line.starts_with(directive)) return false;
+            argument = trim(line.substr(directive.size()));
+            return true;
+        }
+
+        size_t file_index(ShaderPreprocessor::Result& result, const std::filesystem::path& file) {
+            auto it = std::find(result.files.begin(), result.files.end(), file);
+            if (it != result.files.end()) return it - result.files.begin();
+            result.files.push_back(file);
+            return result.files.size() - 1;
+        }
+
+        void expand(ShaderPreprocessor::Result& result, const std::filesystem::path& file, const ShaderDefines& defines, std::vector<std::filesystem::path>& stack) {
+            std::ifstream stream(file);
+            if (!stream.is_open()) {
+                out_error("failed to open shader source {}", file.string());
+                result.success = false;
+                return;
+            }
+
+            const size_t index = file_index(result, file);
+            if (!stack.empty()) result.source += std::format("#line 1 {}\n", index);
+            stack.push_back(file);
+
+            std::string line;
+            size_t line_number {0};
+            while (std::getline(stream, line)) {
+                line_number++;
+                std::string_view argument;
+
+                if (stack.size() == 1 && parse_directive(line, "version", argument)) {
+                    result.source += line + '\n';
+                    for (const std::string& define : defines) result.source += std::format("#define {}\n", define);
+                    result.source += std::format("#line {} {}\n", line_number + 1, index);
+                }
+                else if (parse_directive(line, "include", argument)) {
+                    if (argument.size() < 2 || argument.front() != '"' || argument.back() != '"') {
+                        out_error("{}:{}: expected #include \"file\"", file.string(), line_number);
+                        result.success = false;
+                        result.source += '\n';
+                        continue;
+                    }
+
+                    const std::filesystem::path include = std::filesystem::weakly_canonical(file.parent_path() / argument.substr(1, argument.size() - 2));
+                    const bool included = std::find(result.files.begin(), result.files.end(), include) != result.files.end();
+
+                    if (std::find(stack.begin(), stack.end(), include) != stack.end()) {
+                        out_error("{}:{}: {} includes itself", file.string(), line_number, include.string());
+                        result.success = false;
+                    }
+                    else if (stack.size() >= MAX_INCLUDE_DEPTH) {
+                        out_error("{}:{}: includes nested deeper than {}", file.string(), line_number, MAX_INCLUDE_DEPTH);
+                        result.success = false;
+                    }
+                    else if (!included) {
+                        expand(result, include, defines, stack);
+                    }
+
+                    result.source += std::format("#line {} {}\n", line_number + 1, index);
+                }
+                else {
+                    result.source += line + '\n';
+                }
+            }
+
+            stack.pop_back();
+        }
+    }
+
+    ShaderPreprocessor::Result ShaderPreprocessor::process(const std::filesystem::path& file, const ShaderDefines& defines) {
+        Result result;
+        std::vector<std::filesystem::path> stack;
+        expand(result, std::filesystem::weakly_canonical(file), defines, stack);
+        return result;
+    }
+
+    std::string ShaderPreprocessor::annotate_log(std::string_view log, const std::vector<std::filesystem::path>& files) {
+        std::string annotated(log);
+        if (!annotated.empty() && annotated.back() != '\n') annotated += '\n';
+        for (size_t i {0}; i < files.size(); i++)
+            annotated += std::format("  source {} = {}\n", i, files[i].string());
+        return annotated;
+    }
+}
@@ -2,44 +2,82 @@
 #include "texture.h"
 
 namespace Engine {
-    Texture::Texture(const TextureCreateInfo& create_info) : target(create_info.target), create_info(create_info) {
-        glCreateTextures(target, 1, &id);
-
-        switch (target) {
-            case GL_TEXTURE_2D: {
-                glTextureParameteri(id, GL_TEXTURE_WRAP_S, create_info.wrap);
-                glTextureParameteri(id, GL_TEXTURE_WRAP_T, create_info.wrap);
-                glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, create_info.filter);
-                glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, create_info.filter);
-
-                glTextureStorage2D(id, 1, create_info.format, create_info.width, create_info.height);
-
-                break;
+    namespace {
+        GLenum magnification_filter(GLenum filter) {
+            switch (filter) {
+                case GL_NEAREST:
+                case GL_NEAREST_MIPMAP_NEAREST:
+                case GL_NEAREST_MIPMAP_LINEAR:
+                    return GL_NEAREST;
+                case GL_LINEAR_MIPMAP_NEAREST:
+                case GL_LINEAR_MIPMAP_LINEAR:
+                    return GL_LINEAR;
+                default:
+                    return filter;
             }
         }
     }
 
+    Texture::Texture(const TextureCreateInfo& create_info) : target(create_info.target), create_info(create_info) {
+        allocate();
+    }
+
     void Texture::refactor(unsigned int width, unsigned int height) {
         glDeleteTextures(1, &id);
-        
+
         create_info.width = width;
         create_info.height = height;
-        
+
+        allocate();
+    }
+
+    void Texture::allocate() {
         glCreateTextures(target, 1, &id);
 
+        glTextureParameteri(id, GL_TEXTURE_WRAP_S, create_info.wrap);
+        glTextureParameteri(id, GL_TEXTURE_WRAP_T, create_info.wrap);
+        glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, create_info.filter);
+        glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, magnification_filter(create_info.filter));
+
         switch (target) {
             case GL_TEXTURE_2D: {
-                glTextureParameteri(id, GL_TEXTURE_WRAP_S, create_info.wrap);
-                glTextureParameteri(id, GL_TEXTURE_WRAP_T, create_info.wrap);
-                glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, create_info.filter);
-                glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, create_info.filter);
+                glTextureStorage2D(id, get_levels(), create_info.format, create_info.width, create_info.height);
+                break;
+            }
+            case GL_TEXTURE_2D_ARRAY: {
+                glTextureStorage3D(id, get_levels(), create_info.format, create_info.width, create_info.height, get_layers());
+                break;
+            }
+        }
+    }
 
-                glTextureStorage2D(id, 1, create_info.format, create_info.width, create_info.height);
+    void Texture::upload(const void* data, GLenum format, GLenum type, unsigned int layer) {
+        switch (target) {
+            case GL_TEXTURE_2D: {
+                glTextureSubImage2D(id, 0, 0, 0, create_info.width, create_info.height, format, type, data);
+                break;
+            }
+            case GL_TEXTURE_2D_ARRAY: {
+                glTextureSubImage3D(id, 0, 0, 0, layer, create_info.width, create_info.height, 1, format, type, data);
                 break;
             }
         }
     }
 
+    void Texture::upload(GLuint buffer, GLintptr offset, GLenum format, GLenum type, unsigned int layer) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        upload(reinterpret_cast<const void*>(offset), format, type, layer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    void Texture::clear() {
+        glClearTexImage(id, 0, GL_RED, GL_FLOAT, nullptr);
+    }
+
+    void Texture::generate_mipmaps() {
+        if (get_levels() > 1) glGenerateTextureMipmap(id);
+    }
+
     void Texture::bind(GLuint unit) {
         glBindTextureUnit(unit, id);
     }
@@ -0,0 +1,347 @@
+#include "wave_query.h"
+#include <cmath>
+#include <algorithm>
+#include "jobs.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #include <immintrin.h>
+    #define WAVE_QUERY_AVX2
+    #define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#if defined(__aarch64__)
+    #include <arm_neon.h>
+    #define WAVE_QUERY_NEON
+#endif
+
+// every path does the exact same ieee operations in the same order (no fma, no reciprocal estimates),
+// so scalar, avx2 and neon agree bit for bit and follow the glsl expression for expression
+namespace Engine {
+    namespace {
+        constexpr size_t BLOCK {64};
+
+        struct Surface {
+            float dx, height, dz, sx, sz;
+        };
+
+        inline float lerp(float a, float b, float t) {
+            return a + (b - a) * t;
+        }
+
+        Surface sample_field(const WaveQuery::Field& field, float x, float z) {
+            const float u = x / field.patch_size * static_cast<float>(field.size) - .5f;
+            const float v = z / field.patch_size * static_cast<float>(field.size) - .5f;
+            const float base_u = std::floor(u);
+            const float base_v = std::floor(v);
+            const float tu = u - base_u;
+            const float tv = v - base_v;
+
+            const uint32_t mask {field.size - 1};
+            const uint32_t x0 = static_cast<uint32_t>(static_cast<int32_t>(base_u)) & mask;
+            const uint32_t z0 = static_cast<uint32_t>(static_cast<int32_t>(base_v)) & mask;
+            const uint32_t x1 = (x0 + 1) & mask;
+            const uint32_t z1 = (z0 + 1) & mask;
+
+            const glm::vec4& d00 = field.displacement[z0 * field.size + x0];
+            const glm::vec4& d10 = field.displacement[z0 * field.size + x1];
+            const glm::vec4& d01 = field.displacement[z1 * field.size + x0];
+            const glm::vec4& d11 = field.displacement[z1 * field.size + x1];
+            const glm::vec2& s00 = field.slope[z0 * field.size + x0];
+            const glm::vec2& s10 = field.slope[z0 * field.size + x1];
+            const glm::vec2& s01 = field.slope[z1 * field.size + x0];
+            const glm::vec2& s11 = field.slope[z1 * field.size + x1];
+
+            return Surface {
+                lerp(lerp(d00.x, d10.x, tu), lerp(d01.x, d11.x, tu), tv),
+                lerp(lerp(d00.y, d10.y, tu), lerp(d01.y, d11.y, tu), tv),
+                lerp(lerp(d00.z, d10.z, tu), lerp(d01.z, d11.z, tu), tv),
+                lerp(lerp(s00.x, s10.x, tu), lerp(s01.x, s11.x, tu), tv),
+                lerp(lerp(s00.y, s10.y, tu), lerp(s01.y, s11.y, tu), tv)
+            };
+        }
+
+        Surface sample_state(std::span<const WaveQuery::Layer> layers, float x, float z) {
+            Surface sum {0.f, 0.f, 0.f, 0.f, 0.f};
+            for (const WaveQuery::Layer& layer : layers) {
+                const Surface a = sample_field(layer.previous, x, z);
+                const Surface b = sample_field(layer.current, x, z);
+                sum.dx += lerp(a.dx, b.dx, layer.blend);
+                sum.height += lerp(a.height, b.height, layer.blend);
+                sum.dz += lerp(a.dz, b.dz, layer.blend);
+                sum.sx += lerp(a.sx, b.sx, layer.blend);
+                sum.sz += lerp(a.sz, b.sz, layer.blend);
+            }
+            return sum;
+        }
+
+        void sample_scalar(std::span<const WaveQuery::Layer> layers, const WaveQuery::Batch& batch, size_t iterations, size_t begin, size_t end) {
+            for (size_t i {begin}; i < end; i++) {
+                float x {batch.x[i]};
+                float z {batch.z[i]};
+                for (size_t iteration {0}; iteration < iterations; iteration++) {
+                    const Surface surface = sample_state(layers, x, z);
+                    x = batch.x[i] - surface.dx;
+                    z = batch.z[i] - surface.dz;
+                }
+
+                const Surface surface = sample_state(layers, x, z);
+                const float length = std::sqrt(surface.sx * surface.sx + 1.f + surface.sz * surface.sz);
+                batch.height[i] = surface.height;
+                batch.displacement_x[i] = surface.dx;
+                batch.displacement_z[i] = surface.dz;
+                batch.normal_x[i] = -surface.sx / length;
+                batch.normal_y[i] = 1.f / length;
+                batch.normal_z[i] = -surface.sz / length;
+            }
+        }
+
+#if defined(WAVE_QUERY_AVX2)
+        struct Surface8 {
+            __m256 dx, height, dz, sx, sz;
+        };
+
+        AVX2_TARGET inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+            return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+        }
+
+        AVX2_TARGET inline __m256 bilinear8(const float* base, int stride, int component, const __m256i (&texels)[4], __m256 tu, __m256 tv) {
+            __m256 values[4];
+            for (size_t corner {0}; corner < 4; corner++) {
+                const __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(texels[corner], _mm256_set1_epi32(stride)), _mm256_set1_epi32(component));
+                values[corner] = _mm256_i32gather_ps(base, index, 4);
+            }
+            return lerp8(lerp8(values[0], values[1], tu), lerp8(values[2], values[3], tu), tv);
+        }
+
+        AVX2_TARGET Surface8 sample_field8(const WaveQuery::Field& field, __m256 x, __m256 z) {
+            const __m256 size = _mm256_set1_ps(static_cast<float>(field.size));
+            const __m256 patch_size = _mm256_set1_ps(field.patch_size);
+            const __m256 half = _mm256_set1_ps(.5f);
+
+            const __m256 u = _mm256_sub_ps(_mm256_mul_ps(_mm256_div_ps(x, patch_size), size), half);
+            const __m256 v = _mm256_sub_ps(_mm256_mul_ps(_mm256_div_ps(z, patch_size), size), half);
+            const __m256 base_u = _mm256_floor_ps(u);
+            const __m256 base_v = _mm256_floor_ps(v);
+            const __m256 tu = _mm256_sub_ps(u, base_u);
+            const __m256 tv = _mm256_sub_ps(v, base_v);
+
+            const __m256i mask = _mm256_set1_epi32(static_cast<int>(field.size - 1));
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i row = _mm256_set1_epi32(static_cast<int>(field.size));
+            const __m256i x0 = _mm256_and_si256(_mm256_cvttps_epi32(base_u), mask);
+            const __m256i z0 = _mm256_and_si256(_mm256_cvttps_epi32(base_v), mask);
+            const __m256i x1 = _mm256_and_si256(_mm256_add_epi32(x0, one), mask);
+            const __m256i z1 = _mm256_and_si256(_mm256_add_epi32(z0, one), mask);
+            const __m256i row0 = _mm256_mullo_epi32(z0, row);
+            const __m256i row1 = _mm256_mullo_epi32(z1, row);
+            const __m256i texels[4] {
+                _mm256_add_epi32(row0, x0), _mm256_add_epi32(row0, x1),
+                _mm256_add_epi32(row1, x0), _mm256_add_epi32(row1, x1)
+            };
+
+            const float* displacement = reinterpret_cast<const float*>(field.displacement);
+            const float* slope = reinterpret_cast<const float*>(field.slope);
+            return Surface8 {
+                bilinear8(displacement, 4, 0, texels, tu, tv),
+                bilinear8(displacement, 4, 1, texels, tu, tv),
+                bilinear8(displacement, 4, 2, texels, tu, tv),
+                bilinear8(slope, 2, 0, texels, tu, tv),
+                bilinear8(slope, 2, 1, texels, tu, tv)
+            };
+        }
+
+        AVX2_TARGET Surface8 sample_state8(std::span<const WaveQuery::Layer> layers, __m256 x, __m256 z) {
+            Surface8 sum {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+            for (const WaveQuery::Layer& layer : layers) {
+                const __m256 blend = _mm256_set1_ps(layer.blend);
+                const Surface8 a = sample_field8(layer.previous, x, z);
+                const Surface8 b = sample_field8(layer.current, x, z);
+                sum.dx = _mm256_add_ps(sum.dx, lerp8(a.dx, b.dx, blend));
+                sum.height = _mm256_add_ps(sum.height, lerp8(a.height, b.height, blend));
+                sum.dz = _mm256_add_ps(sum.dz, lerp8(a.dz, b.dz, blend));
+                sum.sx = _mm256_add_ps(sum.sx, lerp8(a.sx, b.sx, blend));
+                sum.sz = _mm256_add_ps(sum.sz, lerp8(a.sz, b.sz, blend));
+            }
+            return sum;
+        }
+
+        AVX2_TARGET size_t sample_avx2(std::span<const WaveQuery::Layer> layers, const WaveQuery::Batch& batch, size_t iterations, size_t begin, size_t end) {
+            const __m256 one = _mm256_set1_ps(1.f);
+            const __m256 sign = _mm256_set1_ps(-0.f);
+
+            size_t i {begin};
+            for (; i + 8 <= end; i += 8) {
+                const __m256 target_x = _mm256_loadu_ps(batch.x.data() + i);
+                const __m256 target_z = _mm256_loadu_ps(batch.z.data() + i);
+                __m256 x {target_x};
+                __m256 z {target_z};
+                for (size_t iteration {0}; iteration < iterations; iteration++) {
+                    const Surface8 surface = sample_state8(layers, x, z);
+                    x = _mm256_sub_ps(target_x, surface.dx);
+                    z = _mm256_sub_ps(target_z, surface.dz);
+                }
+
+                const Surface8 surface = sample_state8(layers, x, z);
+                const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(surface.sx, surface.sx), one), _mm256_mul_ps(surface.sz, surface.sz)));
+                _mm256_storeu_ps(batch.height.data() + i, surface.height);
+                _mm256_storeu_ps(batch.displacement_x.data() + i, surface.dx);
+                _mm256_storeu_ps(batch.displacement_z.data() + i, surface.dz);
+                _mm256_storeu_ps(batch.normal_x.data() + i, _mm256_div_ps(_mm256_xor_ps(surface.sx, sign), length));
+                _mm256_storeu_ps(batch.normal_y.data() + i, _mm256_div_ps(one, length));
+                _mm256_storeu_ps(batch.normal_z.data() + i, _mm256_div_ps(_mm256_xor_ps(surface.sz, sign), length));
+            }
+            return i;
+        }
+#endif
+
+#if defined(WAVE_QUERY_NEON)
+        struct Surface4 {
+            float32x4_t dx, height, dz, sx, sz;
+        };
+
+        inline float32x4_t lerp4(float32x4_t a, float32x4_t b, float32x4_t t) {
+            return vaddq_f32(a, vmulq_f32(vsubq_f32(b, a), t));
+        }
+
+        // neon has no gather, the four texel indices go through the stack
+        inline float32x4_t bilinear4(const float* base, uint32_t stride, uint32_t component, const uint32x4_t (&texels)[4], float32x4_t tu, float32x4_t tv) {
+            float32x4_t values[4];
+            for (size_t corner {0}; corner < 4; corner++) {
+                uint32_t indices[4];
+                vst1q_u32(indices, texels[corner]);
+                const float lanes[4] {
+                    base[indices[0] * stride + component], base[indices[1] * stride + component],
+                    base[indices[2] * stride + component], base[indices[3] * stride + component]
+                };
+                values[corner] = vld1q_f32(lanes);
+            }
+            return lerp4(lerp4(values[0], values[1], tu), lerp4(values[2], values[3], tu), tv);
+        }
+
+        Surface4 sample_field4(const WaveQuery::Field& field, float32x4_t x, float32x4_t z) {
+            const float32x4_t size = vdupq_n_f32(static_cast<float>(field.size));
+            const float32x4_t patch_size = vdupq_n_f32(field.patch_size);
+            const float32x4_t half = vdupq_n_f32(.5f);
+
+            const float32x4_t u = vsubq_f32(vmulq_f32(vdivq_f32(x, patch_size), size), half);
+            const float32x4_t v = vsubq_f32(vmulq_f32(vdivq_f32(z, patch_size), size), half);
+            const float32x4_t base_u = vrndmq_f32(u);
+            const float32x4_t base_v = vrndmq_f32(v);
+            const float32x4_t tu = vsubq_f32(u, base_u);
+            const float32x4_t tv = vsubq_f32(v, base_v);
+
+            const uint32x4_t mask = vdupq_n_u32(field.size - 1);
+            const uint32x4_t one = vdupq_n_u32(1);
+            const uint32x4_t x0 = vandq_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(base_u)), mask);
+            const uint32x4_t z0 = vandq_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(base_v)), mask);
+            const uint32x4_t x1 = vandq_u32(vaddq_u32(x0, one), mask);
+            const uint32x4_t z1 = vandq_u32(vaddq_u32(z0, one), mask);
+            const uint32x4_t row0 = vmulq_n_u32(z0, field.size);
+            const uint32x4_t row1 = vmulq_n_u32(z1, field.size);
+            const uint32x4_t texels[4] {
+                vaddq_u32(row0, x0), vaddq_u32(row0, x1),
+                vaddq_u32(row1, x0), vaddq_u32(row1, x1)
+            };
+
+            const float* displacement = reinterpret_cast<const float*>(field.displacement);
+            const float* slope = reinterpret_cast<const float*>(field.slope);
+            return Surface4 {
+                bilinear4(displacement, 4, 0, texels, tu, tv),
+                bilinear4(displacement, 4, 1, texels, tu, tv),
+                bilinear4(displacement, 4, 2, texels, tu, tv),
+                bilinear4(slope, 2, 0, texels, tu, tv),
+                bilinear4(slope, 2, 1, texels, tu, tv)
+            };
+        }
+
+        Surface4 sample_state4(std::span<const WaveQuery::Layer> layers, float32x4_t x, float32x4_t z) {
+            Surface4 sum {vdupq_n_f32(0.f), vdupq_n_f32(0.f), vdupq_n_f32(0.f), vdupq_n_f32(0.f), vdupq_n_f32(0.f)};
+            for (const WaveQuery::Layer& layer : layers) {
+                const float32x4_t blend = vdupq_n_f32(layer.blend);
+                const Surface4 a = sample_field4(layer.previous, x, z);
+                const Surface4 b = sample_field4(layer.current, x, z);
+                sum.dx = vaddq_f32(sum.dx, lerp4(a.dx, b.dx, blend));
+                sum.height = vaddq_f32(sum.height, lerp4(a.height, b.height, blend));
+                sum.dz = vaddq_f32(sum.dz, lerp4(a.dz, b.dz, blend));
+                sum.sx = vaddq_f32(sum.sx, lerp4(a.sx, b.sx, blend));
+                sum.sz = vaddq_f32(sum.sz, lerp4(a.sz, b.sz, blend));
+            }
+            return sum;
+        }
+
+        size_t sample_neon(std::span<const WaveQuery::Layer> layers, const WaveQuery::Batch& batch, size_t iterations, size_t begin, size_t end) {
+            const float32x4_t one = vdupq_n_f32(1.f);
+
+            size_t i {begin};
+            for (; i + 4 <= end; i += 4) {
+                const float32x4_t target_x = vld1q_f32(batch.x.data() + i);
+                const float32x4_t target_z = vld1q_f32(batch.z.data() + i);
+                float32x4_t x {target_x};
+                float32x4_t z {target_z};
+                for (size_t iteration {0}; iteration < iterations; iteration++) {
+                    const Surface4 surface = sample_state4(layers, x, z);
+                    x = vsubq_f32(target_x, surface.dx);
+                    z = vsubq_f32(target_z, surface.dz);
+                }
+
+                const Surface4 surface = sample_state4(layers, x, z);
+                const float32x4_t length = vsqrtq_f32(vaddq_f32(vaddq_f32(vmulq_f32(surface.sx, surface.sx), one), vmulq_f32(surface.sz, surface.sz)));
+                vst1q_f32(batch.height.data() + i, surface.height);
+                vst1q_f32(batch.displacement_x.data() + i, surface.dx);
+                vst1q_f32(batch.displacement_z.data() + i, surface.dz);
+                vst1q_f32(batch.normal_x.data() + i, vdivq_f32(vnegq_f32(surface.sx), length));
+                vst1q_f32(batch.normal_y.data() + i, vdivq_f32(one, length));
+                vst1q_f32(batch.normal_z.data() + i, vdivq_f32(vnegq_f32(surface.sz), length));
+            }
+            return i;
+        }
+#endif
+
+        WaveQuery::Isa detect_isa() {
+#if defined(WAVE_QUERY_AVX2)
+            if (__builtin_cpu_supports("avx2")) return WaveQuery::Isa::Avx2;
+#endif
+#if defined(WAVE_QUERY_NEON)
+            return WaveQuery::Isa::Neon;
+#endif
+            return WaveQuery::Isa::Scalar;
+        }
+    }
+
+    WaveQuery::Isa WaveQuery::get_isa() {
+        static const Isa isa {detect_isa()};
+        return isa;
+    }
+
+    std::string_view WaveQuery::isa_to_string_view(Isa isa) {
+        switch (isa) {
+            case Isa::Scalar: return "scalar";
+            case Isa::Avx2: return "avx2";
+            case Isa::Neon: return "neon";
+            default: return "undefined";
+        };
+    }
+
+    void WaveQuery::sample(std::span<const Layer> layers, const Batch& batch, size_t iterations) {
+        sample(get_isa(), layers, batch, iterations);
+    }
+
+    void WaveQuery::sample(Isa isa, std::span<const Layer> layers, const Batch& batch, size_t iterations) {
+        if (isa != get_isa()) isa = Isa::Scalar;
+        const size_t count {batch.x.size()};
+
+        Jobs::parallel_for((count + BLOCK - 1) / BLOCK, 16, [&](size_t first, size_t last) {
+            const size_t begin {first * BLOCK};
+            const size_t end {std::min(last * BLOCK, count)};
+            size_t tail {begin};
+
+#if defined(WAVE_QUERY_AVX2)
+            if (isa == Isa::Avx2) tail = sample_avx2(layers, batch, iterations, begin, end);
+#endif
+#if defined(WAVE_QUERY_NEON)
+            if (isa == Isa::Neon) tail = sample_neon(layers, batch, iterations, begin, end);
+#endif
+            sample_scalar(layers, batch, iterations, tail, end);
+        });
+    }
+}
@@ -10,6 +10,11 @@ namespace Engine {
     {
         if (!glfwInit()) return;
 
+        // 4.5 core covers dsa and compute, and is what mesa llvmpipe exposes without a gpu
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
         window = glfwCreateWindow(width, height, title.data(), nullptr, nullptr);
         glfwSetWindowPos(window, 200, 100);
 
@@ -25,6 +30,8 @@ namespace Engine {
             glfwTerminate();
         }
 
+        Profiler::set_gpu_enabled(GLAD_GL_VERSION_3_3);
+
         {
             IMGUI_CHECKVERSION();
             ImGui::CreateContext();
@@ -43,6 +50,7 @@ namespace Engine {
 
     Window::~Window()
     {        
+        renderer.reset();
         ImPlot::DestroyContext();
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
@@ -51,6 +59,10 @@ namespace Engine {
         glfwTerminate();
     }
 
+    Game::Renderer* Window::get_renderer() {
+        return renderer.get();
+    }
+
     void Window::run()
     {
         while (!glfwWindowShouldClose(window)) {
@@ -61,6 +73,7 @@ namespace Engine {
             Time::Timer::delta_time = time - last_time;
             last_time = time;
 
+            Profiler::new_frame();
             Input::update();
             glfwPollEvents();
 
@@ -72,8 +85,11 @@ namespace Engine {
 
             renderer->render();
 
-            ImGui::Render();
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            {
+                Profiler::Scope scope("imgui");
+                ImGui::Render();
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            }
             GLFWwindow* backup_current_context = glfwGetCurrentContext();
             ImGui::UpdatePlatformWindows();
             ImGui::RenderPlatformWindowsDefault();
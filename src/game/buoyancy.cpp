@@ -0,0 +1,218 @@
+#include "buoyancy.h"
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "jobs.h"
+#include "profiler.h"
+
+namespace Engine::Game {
+    constexpr float WATER_DENSITY {1025.f};
+    constexpr float GRAVITY {9.81f};
+
+    namespace {
+        // voxel centres of the unit cube; the hull is scaled per body
+        constexpr float HULL[Buoyancy::HULL_POINTS][3] {
+            {-.25f, -.25f, -.25f}, {.25f, -.25f, -.25f}, {-.25f, .25f, -.25f}, {.25f, .25f, -.25f},
+            {-.25f, -.25f,  .25f}, {.25f, -.25f,  .25f}, {-.25f, .25f,  .25f}, {.25f, .25f,  .25f}
+        };
+
+        // v + 2 q.xyz x (q.xyz x v + w v), as in the vertex shader
+        inline glm::vec3 rotate(float w, float x, float y, float z, glm::vec3 v) {
+            const glm::vec3 axis(x, y, z);
+            return v + 2.f * glm::cross(axis, glm::cross(axis, v) + w * v);
+        }
+    }
+
+    Buoyancy::Buoyancy(const BuoyancySettings& settings) {
+        rebuild(settings);
+    }
+
+    void Buoyancy::rebuild(const BuoyancySettings& new_settings) {
+        settings = new_settings;
+        const size_t count {settings.count};
+        const size_t points {count * HULL_POINTS};
+
+        for (auto* values : {&position_x, &position_y, &position_z, &velocity_x, &velocity_y, &velocity_z,
+                             &orientation_x, &orientation_y, &orientation_z, &angular_velocity_x, &angular_velocity_y, &angular_velocity_z,
+                             &scale, &mass})
+            values->assign(count, 0.f);
+        orientation_w.assign(count, 1.f);
+
+        for (auto* values : {&offset_x, &offset_y, &offset_z, &point_x, &point_z,
+                             &height, &displacement_x, &displacement_z, &normal_x, &normal_y, &normal_z})
+            values->assign(points, 0.f);
+
+        // a square of bodies around the origin, dropped from a little above the surface with a random tilt
+        std::mt19937 generator(settings.seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        const size_t side {static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(count))))};
+        const float extent {static_cast<float>(side) * settings.spacing};
+
+        for (size_t i {0}; i < count; i++) {
+            scale[i] = settings.min_scale + (settings.max_scale - settings.min_scale) * unit(generator);
+            mass[i] = settings.density * scale[i] * scale[i] * scale[i];
+
+            position_x[i] = (static_cast<float>(i % side) + unit(generator) * .5f) * settings.spacing - extent * .5f;
+            position_y[i] = 1.f + 2.f * unit(generator);
+            position_z[i] = (static_cast<float>(i / side) + unit(generator) * .5f) * settings.spacing - extent * .5f;
+
+            const glm::vec3 axis = glm::normalize(glm::vec3(unit(generator) - .5f, unit(generator) - .5f, unit(generator) - .5f) + glm::vec3(0.f, 0.f, 1e-3f));
+            const float half_angle {(unit(generator) - .5f) * .6f};
+            orientation_w[i] = std::cos(half_angle);
+            orientation_x[i] = axis.x * std::sin(half_angle);
+            orientation_y[i] = axis.y * std::sin(half_angle);
+            orientation_z[i] = axis.z * std::sin(half_angle);
+        }
+
+        previous_position_x = position_x;
+        previous_position_y = position_y;
+        previous_position_z = position_z;
+        previous_orientation_w = orientation_w;
+        previous_orientation_x = orientation_x;
+        previous_orientation_y = orientation_y;
+        previous_orientation_z = orientation_z;
+    }
+
+    void Buoyancy::step(Ocean& ocean, double time, float dt) {
+        Profiler::Scope scope("buoyancy", false);
+        auto start = std::chrono::steady_clock::now();
+        const size_t count {settings.count};
+        if (count == 0) return;
+
+        previous_position_x = position_x;
+        previous_position_y = position_y;
+        previous_position_z = position_z;
+        previous_orientation_w = orientation_w;
+        previous_orientation_x = orientation_x;
+        previous_orientation_y = orientation_y;
+        previous_orientation_z = orientation_z;
+
+        Jobs::parallel_for(count, 256, [&](size_t begin, size_t end) {
+            for (size_t i {begin}; i < end; i++) {
+                for (size_t j {0}; j < HULL_POINTS; j++) {
+                    const size_t p {i * HULL_POINTS + j};
+                    const glm::vec3 offset = rotate(orientation_w[i], orientation_x[i], orientation_y[i], orientation_z[i],
+                        glm::vec3(HULL[j][0], HULL[j][1], HULL[j][2]) * scale[i]);
+                    offset_x[p] = offset.x;
+                    offset_y[p] = offset.y;
+                    offset_z[p] = offset.z;
+                    point_x[p] = position_x[i] + offset.x;
+                    point_z[p] = position_z[i] + offset.z;
+                }
+            }
+        });
+
+        // one query for every hull point of every body
+        ocean.query(WaveQuery::Batch {point_x, point_z, height, displacement_x, displacement_z, normal_x, normal_y, normal_z}, time);
+
+        Jobs::parallel_for(count, 256, [&](size_t begin, size_t end) {
+            for (size_t i {begin}; i < end; i++) {
+                const float s {scale[i]};
+                const float m {mass[i]};
+                const glm::vec3 velocity(velocity_x[i], velocity_y[i], velocity_z[i]);
+                const glm::vec3 angular_velocity(angular_velocity_x[i], angular_velocity_y[i], angular_velocity_z[i]);
+
+                // each voxel holds an eighth of the volume and mass and is half the body tall
+                const float voxel_volume {s * s * s / HULL_POINTS};
+                const float voxel_mass {m / HULL_POINTS};
+                const float voxel_height {s * .5f};
+
+                glm::vec3 force(0.f, -GRAVITY * m, 0.f);
+                glm::vec3 torque(0.f);
+                float submerged {0.f};
+
+                for (size_t j {0}; j < HULL_POINTS; j++) {
+                    const size_t p {i * HULL_POINTS + j};
+                    const glm::vec3 offset(offset_x[p], offset_y[p], offset_z[p]);
+                    const float depth {height[p] - (position_y[i] + offset.y)};
+                    const float fraction {std::clamp(depth / voxel_height + .5f, 0.f, 1.f)};
+                    if (fraction <= 0.f) continue;
+
+                    // archimedes on the submerged part of the voxel, plus drag against the water it moves through
+                    const glm::vec3 point_velocity = velocity + glm::cross(angular_velocity, offset);
+                    const glm::vec3 voxel_force = glm::vec3(0.f, WATER_DENSITY * GRAVITY * voxel_volume * fraction, 0.f)
+                        - point_velocity * (settings.linear_drag * voxel_mass * fraction);
+
+                    force += voxel_force;
+                    torque += glm::cross(offset, voxel_force);
+                    submerged += fraction;
+                }
+
+                // isotropic solid cube inertia, so the torque needs no rotation into body space
+                const float inertia {m * s * s / 6.f};
+                const glm::vec3 new_velocity = velocity + force * (dt / m);
+                const glm::vec3 new_angular_velocity = (angular_velocity + torque * (dt / inertia))
+                    * std::max(0.f, 1.f - settings.angular_drag * dt * submerged / HULL_POINTS);
+
+                velocity_x[i] = new_velocity.x;
+                velocity_y[i] = new_velocity.y;
+                velocity_z[i] = new_velocity.z;
+                angular_velocity_x[i] = new_angular_velocity.x;
+                angular_velocity_y[i] = new_angular_velocity.y;
+                angular_velocity_z[i] = new_angular_velocity.z;
+
+                // semi-implicit euler: the new velocities move the body
+                position_x[i] += new_velocity.x * dt;
+                position_y[i] += new_velocity.y * dt;
+                position_z[i] += new_velocity.z * dt;
+
+                // q += dt/2 (0, w) q
+                const float w {orientation_w[i]};
+                const float x {orientation_x[i]};
+                const float y {orientation_y[i]};
+                const float z {orientation_z[i]};
+                const glm::vec3 half = new_angular_velocity * (dt * .5f);
+                const float qw {w - half.x * x - half.y * y - half.z * z};
+                const float qx {x + half.x * w + half.y * z - half.z * y};
+                const float qy {y - half.x * z + half.y * w + half.z * x};
+                const float qz {z + half.x * y - half.y * x + half.z * w};
+                const float inverse_length {1.f / std::sqrt(qw * qw + qx * qx + qy * qy + qz * qz)};
+                orientation_w[i] = qw * inverse_length;
+                orientation_x[i] = qx * inverse_length;
+                orientation_y[i] = qy * inverse_length;
+                orientation_z[i] = qz * inverse_length;
+            }
+        });
+
+        step_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Buoyancy::draw(Shader& shader, float alpha) {
+        const size_t count {settings.count};
+        if (count == 0) return;
+
+        const size_t bytes {count * sizeof(Instance)};
+        if (!stream || stream->get_frame_size() < bytes) stream = std::make_unique<StreamBuffer>(bytes);
+        if (!vao) vao = std::make_unique<VAO>();
+
+        stream->begin_frame();
+        StreamBuffer::Allocation allocation = stream->allocate(bytes);
+        if (!allocation.data) {
+            stream->end_frame();
+            return;
+        }
+
+        Instance* instances {static_cast<Instance*>(allocation.data)};
+        Jobs::parallel_for(count, 1024, [&](size_t begin, size_t end) {
+            for (size_t i {begin}; i < end; i++) {
+                const glm::vec3 position = glm::mix(
+                    glm::vec3(previous_position_x[i], previous_position_y[i], previous_position_z[i]),
+                    glm::vec3(position_x[i], position_y[i], position_z[i]), alpha);
+
+                // nlerp along the shorter arc; steps are small enough that it matches slerp
+                const glm::vec4 previous(previous_orientation_x[i], previous_orientation_y[i], previous_orientation_z[i], previous_orientation_w[i]);
+                glm::vec4 current(orientation_x[i], orientation_y[i], orientation_z[i], orientation_w[i]);
+                if (glm::dot(previous, current) < 0.f) current = -current;
+
+                instances[i] = Instance {glm::vec4(position, scale[i]), glm::normalize(glm::mix(previous, current, alpha))};
+            }
+        });
+
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, stream->get_id(), allocation.offset, bytes);
+        shader.use();
+        vao->bind();
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(count));
+        stream->end_frame();
+    }
+}
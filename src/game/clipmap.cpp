@@ -0,0 +1,101 @@
+#include "clipmap.h"
+#include <algorithm>
+
+namespace Engine::Game {
+    Clipmap::Clipmap(const ClipmapSettings& settings) {
+        rebuild(settings);
+    }
+
+    void Clipmap::rebuild(const ClipmapSettings& new_settings) {
+        settings = new_settings;
+        settings.grid_size = std::max<size_t>(8, settings.grid_size / 4 * 4);
+        settings.levels = std::max<size_t>(1, settings.levels);
+
+        const size_t n {settings.grid_size};
+        grid = std::make_unique<GridMeshBuilder>(n, settings.layout);
+
+        // the finer level's hole is n/2 cells wide and, depending on how both levels snapped, shifted by one cell in x and/or z
+        for (size_t variant {0}; variant <= VARIANT_FULL; variant++) {
+            const size_t hole_x {n / 4 + (variant & 1)};
+            const size_t hole_z {n / 4 + ((variant >> 1) & 1)};
+
+            ranges[variant] = variant == VARIANT_FULL
+                ? grid->add()
+                : grid->add(hole_x, hole_z, hole_x + n / 2, hole_z + n / 2);
+            reports[variant] = grid->report(ranges[variant]);
+        }
+
+        vao = std::make_unique<VAO>();
+        ebo = std::make_unique<Buffer>();
+        ebo->data(grid->get_index_data(), grid->get_index_bytes());
+        vao->bind_index_buffer(ebo->get_id());
+
+        levels.resize(settings.levels);
+        update(camera_position);
+    }
+
+    void Clipmap::update(glm::vec3 position) {
+        camera_position = position;
+        const glm::vec2 camera_xz {position.x, position.z};
+        const float half_grid {.5f * settings.grid_size};
+
+        for (size_t l {0}; l < levels.size(); l++) {
+            const float cell_size = settings.cell_size * std::exp2(static_cast<float>(l));
+
+            // snapping to twice the cell size keeps vertices on the coarser level's lattice, so nothing swims
+            const glm::vec2 center = glm::floor(camera_xz / (2.f * cell_size)) * 2.f * cell_size;
+            levels[l].origin = center - half_grid * cell_size;
+            levels[l].cell_size = cell_size;
+
+            if (l == 0) {
+                levels[l].variant = VARIANT_FULL;
+                continue;
+            }
+
+            const glm::vec2 inner_center = glm::floor(camera_xz / cell_size) * cell_size;
+            const glm::vec2 offset = glm::round((inner_center - center) / cell_size);
+            levels[l].variant = static_cast<size_t>(offset.x) + 2 * static_cast<size_t>(offset.y);
+        }
+    }
+
+    void Clipmap::draw(Shader& shader) {
+        shader
+            .set_uniform_float("clipmap_grid_size", static_cast<float>(settings.grid_size))
+            .use();
+        vao->bind();
+
+        // the largest index of the type restarts the strip, so no restart index has to be set
+        const bool strips {grid->get_mode() == GL_TRIANGLE_STRIP};
+        if (strips) glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+
+        for (const Level& level : levels) {
+            shader
+                .set_uniform_vec2("clipmap_origin", level.origin)
+                .set_uniform_float("clipmap_cell_size", level.cell_size);
+            glDrawElements(
+                grid->get_mode(),
+                static_cast<GLsizei>(ranges[level.variant].count),
+                grid->get_index_type(),
+                reinterpret_cast<void*>(ranges[level.variant].offset * grid->get_index_size())
+            );
+        }
+
+        if (strips) glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+    }
+
+    size_t Clipmap::get_level_vertex_count(size_t level) {
+        return reports[levels[level].variant].vertices;
+    }
+
+    size_t Clipmap::get_level_triangle_count(size_t level) {
+        return reports[levels[level].variant].triangles;
+    }
+
+    const GridMeshBuilder::Report& Clipmap::get_level_report(size_t level) {
+        return reports[levels[level].variant];
+    }
+
+    size_t Clipmap::get_index_bytes() {
+        return grid->get_index_bytes();
+    }
+}
@@ -1,9 +1,22 @@
 #include "window.h"
+#include "headless.h"
 
 
 using namespace Engine;
 
-int main() {
-    Window::create_window(1536, 864, "").run();
+int main(int argc, char** argv) {
+    std::span<char*> arguments(argv + 1, argc - 1);
+    auto has_argument = [&](std::string_view name) {
+        return std::ranges::any_of(arguments, [name](char* argument) { return std::string_view(argument) == name; });
+    };
+
+    // baking needs no window either
+    if (has_argument("--headless") || has_argument("--bake"))
+        return Headless(BenchmarkSettings::from_arguments(arguments)).run();
+
+    Window& window = Window::create_window(1536, 864, "");
+    BenchmarkSettings settings = BenchmarkSettings::from_arguments(arguments);
+    if (!settings.baked_file.empty()) window.get_renderer()->get_ocean()->load_bake(settings.baked_file);
+    window.run();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,753 @@
+#include "ocean.h"
+#include "ocean_bake.h"
+#include <chrono>
+#include <numbers>
+#include <cmath>
+#include <bit>
+#include <limits>
+#include <span>
+#include <algorithm>
+#include "fft.h"
+#include "jobs.h"
+#include "philox.h"
+#include "profiler.h"
+
+namespace Engine::Game {
+    constexpr float GRAVITY {9.81f};
+    constexpr float PHILLIPS_CONSTANT {3e-4f};
+
+    namespace {
+        inline std::complex<float> mul(std::complex<float> a, std::complex<float> b) {
+            return std::complex<float>(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+        }
+
+        // rows first, then columns gathered into small contiguous blocks so every transform runs on linear memory
+        void inverse_fft_2d(std::complex<float>* const* fields, size_t field_count, size_t size) {
+            auto plan = FFT::get_plan<float>(size);
+
+            Jobs::parallel_for(field_count * size, 8, [&](size_t begin, size_t end) {
+                for (size_t i {begin}; i < end; i++) {
+                    std::complex<float>* row = fields[i / size] + (i % size) * size;
+                    plan->execute(row, FFT::Direction::Inverse);
+                }
+            });
+
+            constexpr size_t COLUMN_BLOCK {8};
+            const size_t blocks {(size + COLUMN_BLOCK - 1) / COLUMN_BLOCK};
+
+            Jobs::parallel_for(field_count * blocks, 1, [&](size_t begin, size_t end) {
+                thread_local std::vector<std::complex<float>> columns;
+                columns.resize(COLUMN_BLOCK * size);
+
+                for (size_t i {begin}; i < end; i++) {
+                    std::complex<float>* field = fields[i / blocks];
+                    const size_t x0 {(i % blocks) * COLUMN_BLOCK};
+                    const size_t width {std::min(COLUMN_BLOCK, size - x0)};
+
+                    for (size_t z {0}; z < size; z++)
+                        for (size_t c {0}; c < width; c++)
+                            columns[c * size + z] = field[z * size + x0 + c];
+
+                    for (size_t c {0}; c < width; c++)
+                        plan->execute(columns.data() + c * size, FFT::Direction::Inverse);
+
+                    for (size_t z {0}; z < size; z++)
+                        for (size_t c {0}; c < width; c++)
+                            field[z * size + x0 + c] = columns[c * size + z];
+                }
+            });
+        }
+
+        float spectrum_density(const OceanSettings& settings, float kx, float kz) {
+            const float k = std::sqrt(kx * kx + kz * kz);
+            if (k < 1e-6f) return 0.f;
+
+            const float wind_angle = glm::radians(settings.wind_direction);
+            const float cos_theta = (kx * std::cos(wind_angle) + kz * std::sin(wind_angle)) / k;
+
+            switch (settings.spectrum) {
+                case OceanSpectrum::Phillips: {
+                    const float largest_wave = settings.wind_speed * settings.wind_speed / GRAVITY;
+                    const float smallest_wave = largest_wave * .001f;
+                    const float k2 = k * k;
+                    return settings.amplitude * PHILLIPS_CONSTANT
+                        * std::exp(-1.f / (k2 * largest_wave * largest_wave)) / (k2 * k2)
+                        * std::pow(cos_theta * cos_theta, settings.spread)
+                        * std::exp(-k2 * smallest_wave * smallest_wave);
+                }
+                case OceanSpectrum::Jonswap: {
+                    if (cos_theta <= 0.f) return 0.f;
+
+                    const float omega = std::sqrt(GRAVITY * k);
+                    const float alpha = .076f * std::pow(settings.wind_speed * settings.wind_speed / (settings.fetch * GRAVITY), .22f);
+                    const float omega_peak = 22.f * std::cbrt(GRAVITY * GRAVITY / (settings.wind_speed * settings.fetch));
+                    const float sigma = omega <= omega_peak ? .07f : .09f;
+                    const float peak_offset = (omega - omega_peak) / (sigma * omega_peak);
+                    const float gamma = std::pow(3.3f, std::exp(-.5f * peak_offset * peak_offset));
+                    const float ratio = omega_peak / omega;
+
+                    const float spectrum = alpha * GRAVITY * GRAVITY / std::pow(omega, 5.f) * std::exp(-1.25f * ratio * ratio * ratio * ratio) * gamma;
+                    const float d_omega_d_k = GRAVITY / (2.f * omega);
+                    // cos^2s normalised over the half plane facing the wind, 2 / pi for s = 1
+                    const float normalisation = std::sqrt(std::numbers::pi_v<float>) * std::tgamma(settings.spread + .5f) / std::tgamma(settings.spread + 1.f);
+                    const float directional = std::pow(cos_theta * cos_theta, settings.spread) / normalisation;
+                    return settings.amplitude * spectrum * d_omega_d_k / k * directional;
+                }
+            }
+            return 0.f;
+        }
+
+        struct Grid {
+            std::vector<float> k_x;
+            std::vector<float> k_z;
+        };
+
+        struct Noise {
+            std::vector<std::complex<float>> xi;
+        };
+
+        struct Dispersion {
+            std::vector<float> omega;
+        };
+
+        struct Amplitudes {
+            std::vector<std::complex<float>> h0;
+            std::vector<std::complex<float>> h0_minus_conj;
+        };
+    }
+
+    struct Ocean::Spectrum {
+        OceanSettings settings;
+        std::shared_ptr<const Grid> grid;
+        std::shared_ptr<const Noise> noise;
+        std::shared_ptr<const Dispersion> dispersion;
+        std::shared_ptr<const Amplitudes> amplitudes;
+        uint32_t rebuilt_stages {0};
+        float build_ms {0.f};
+    };
+
+    float OceanSettings::get_patch_size(size_t cascade) const {
+        return patch_size / std::pow(cascade_scale, static_cast<float>(cascade));
+    }
+
+    float OceanSettings::get_band_start(size_t cascade) const {
+        if (cascade == 0) return 0.f;
+        if (cascade >= cascade_count) return std::numeric_limits<float>::infinity();
+
+        // the geometric mean of the finer tile's fundamental and the coarser tile's nyquist wavenumber, which keeps the
+        // split equally far, in octaves, from the coarsest wave one cascade can hold and the finest the other can
+        const float fundamental = 2.f * std::numbers::pi_v<float> / get_patch_size(cascade);
+        const float nyquist = std::numbers::pi_v<float> * static_cast<float>(resolution) / get_patch_size(cascade - 1);
+        return std::sqrt(fundamental * nyquist);
+    }
+
+    uint32_t Ocean::get_invalidated_stages(const OceanSettings& from, const OceanSettings& to) {
+        uint32_t stages {0};
+        if (from.resolution != to.resolution || from.patch_size != to.patch_size ||
+            from.cascade_count != to.cascade_count || from.cascade_scale != to.cascade_scale)
+            stages |= STAGE_GRID;
+        if (from.resolution != to.resolution || from.seed != to.seed || from.cascade_count != to.cascade_count) stages |= STAGE_NOISE;
+        if (from.depth != to.depth || from.loop_period != to.loop_period) stages |= STAGE_DISPERSION;
+        if (from.spectrum != to.spectrum || from.wind_speed != to.wind_speed || from.wind_direction != to.wind_direction ||
+            from.fetch != to.fetch || from.amplitude != to.amplitude || from.spread != to.spread)
+            stages |= STAGE_AMPLITUDES;
+
+        // then along the edges to everything that reads a rebuilt stage
+        if (stages & STAGE_GRID) stages |= STAGE_DISPERSION | STAGE_AMPLITUDES;
+        if (stages & STAGE_NOISE) stages |= STAGE_AMPLITUDES;
+        return stages;
+    }
+
+    std::shared_ptr<const Ocean::Spectrum> Ocean::build_spectrum(const std::shared_ptr<const Spectrum>& base, const OceanSettings& settings, uint32_t stages) {
+        auto start = std::chrono::steady_clock::now();
+        auto spectrum = std::make_shared<Spectrum>();
+        spectrum->settings = settings;
+        if (!base) stages = STAGE_GRID | STAGE_NOISE | STAGE_DISPERSION | STAGE_AMPLITUDES;
+        spectrum->rebuilt_stages = stages;
+
+        const size_t size {settings.resolution};
+        const size_t count {size * size};
+        const size_t cascade_count {settings.cascade_count};
+
+        if (stages & STAGE_GRID) {
+            auto grid = std::make_shared<Grid>();
+            grid->k_x.resize(cascade_count * count);
+            grid->k_z.resize(cascade_count * count);
+            for (size_t cascade {0}; cascade < cascade_count; cascade++) {
+                const float dk = 2.f * std::numbers::pi_v<float> / settings.get_patch_size(cascade);
+                float* k_x {grid->k_x.data() + cascade * count};
+                float* k_z {grid->k_z.data() + cascade * count};
+                for (size_t z {0}; z < size; z++) {
+                    for (size_t x {0}; x < size; x++) {
+                        const float m_x = static_cast<float>(x < size / 2 ? static_cast<long>(x) : static_cast<long>(x) - static_cast<long>(size));
+                        const float m_z = static_cast<float>(z < size / 2 ? static_cast<long>(z) : static_cast<long>(z) - static_cast<long>(size));
+                        k_x[z * size + x] = m_x * dk;
+                        k_z[z * size + x] = m_z * dk;
+                    }
+                }
+            }
+            spectrum->grid = std::move(grid);
+        }
+        else spectrum->grid = base->grid;
+
+        if (stages & STAGE_NOISE) {
+            auto noise = std::make_shared<Noise>();
+            noise->xi.resize(cascade_count * count);
+
+            // counted by the signed wavenumber index, so every row is drawn independently and the result is the same for any
+            // worker count; a mode also keeps its noise when the resolution changes
+            Jobs::parallel_for(cascade_count * size, 16, [&](size_t begin, size_t end) {
+                for (size_t row {begin}; row < end; row++) {
+                    const size_t cascade {row / size};
+                    const size_t z {row % size};
+                    const Philox::Key key {settings.seed, static_cast<uint32_t>(cascade)};
+                    const int32_t m_z = z < size / 2 ? static_cast<int32_t>(z) : static_cast<int32_t>(z) - static_cast<int32_t>(size);
+
+                    for (size_t x {0}; x < size; x++) {
+                        const int32_t m_x = x < size / 2 ? static_cast<int32_t>(x) : static_cast<int32_t>(x) - static_cast<int32_t>(size);
+                        const Philox::Counter counter {static_cast<uint32_t>(m_x), static_cast<uint32_t>(m_z), 0u, 0u};
+                        noise->xi[row * size + x] = Philox::gaussian_pair(counter, key);
+                    }
+                }
+            });
+            spectrum->noise = std::move(noise);
+        }
+        else spectrum->noise = base->noise;
+
+        const Grid& grid = *spectrum->grid;
+
+        if (stages & STAGE_DISPERSION) {
+            auto dispersion = std::make_shared<Dispersion>();
+            dispersion->omega.resize(cascade_count * count);
+            const float base_omega = settings.loop_period > 0.f ? 2.f * std::numbers::pi_v<float> / settings.loop_period : 0.f;
+
+            Jobs::parallel_for(cascade_count * size, 16, [&](size_t begin, size_t end) {
+                for (size_t i {begin * size}; i < end * size; i++) {
+                    const float k = std::sqrt(grid.k_x[i] * grid.k_x[i] + grid.k_z[i] * grid.k_z[i]);
+                    // w^2 = g k tanh(k d), which is the deep water w^2 = g k once the depth is half a wavelength
+                    float omega = std::sqrt(GRAVITY * k * std::tanh(k * settings.depth));
+                    if (base_omega > 0.f) omega = std::floor(omega / base_omega) * base_omega;
+                    dispersion->omega[i] = omega;
+                }
+            });
+            spectrum->dispersion = std::move(dispersion);
+        }
+        else spectrum->dispersion = base->dispersion;
+
+        if (stages & STAGE_AMPLITUDES) {
+            auto amplitudes = std::make_shared<Amplitudes>();
+            amplitudes->h0.assign(cascade_count * count, {});
+            amplitudes->h0_minus_conj.resize(cascade_count * count);
+            const Noise& noise = *spectrum->noise;
+
+            Jobs::parallel_for(cascade_count * size, 16, [&](size_t begin, size_t end) {
+                for (size_t row {begin}; row < end; row++) {
+                    const size_t cascade {row / size};
+                    const size_t z {row % size};
+                    const float dk = 2.f * std::numbers::pi_v<float> / settings.get_patch_size(cascade);
+                    const float band_start {settings.get_band_start(cascade)};
+                    const float band_end {settings.get_band_start(cascade + 1)};
+
+                    // the nyquist row and column have no conjugate partner, so they would leak into the packed imaginary parts
+                    if (z == size / 2) continue;
+                    for (size_t x {0}; x < size; x++) {
+                        if (x == size / 2) continue;
+                        const size_t i {row * size + x};
+                        const float k = std::sqrt(grid.k_x[i] * grid.k_x[i] + grid.k_z[i] * grid.k_z[i]);
+                        if (k < band_start || k >= band_end) continue;
+                        amplitudes->h0[i] = noise.xi[i] * std::sqrt(spectrum_density(settings, grid.k_x[i], grid.k_z[i]) * dk * dk * .5f);
+                    }
+                }
+            });
+
+            Jobs::parallel_for(cascade_count * size, 16, [&](size_t begin, size_t end) {
+                for (size_t row {begin}; row < end; row++) {
+                    const std::complex<float>* h0 {amplitudes->h0.data() + row / size * count};
+                    const size_t z {row % size};
+                    for (size_t x {0}; x < size; x++) {
+                        const size_t minus {((size - z) % size) * size + (size - x) % size};
+                        amplitudes->h0_minus_conj[row * size + x] = std::conj(h0[minus]);
+                    }
+                }
+            });
+            spectrum->amplitudes = std::move(amplitudes);
+        }
+        else spectrum->amplitudes = base->amplitudes;
+
+        spectrum->build_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return spectrum;
+    }
+
+    Ocean::Ocean(const OceanSettings& settings) {
+        rebuild(settings);
+    }
+
+    Ocean::~Ocean() {
+        Jobs::wait(rebuild_job);
+        Jobs::wait(simulation_job);
+    }
+
+    void Ocean::rebuild(const OceanSettings& new_settings) {
+        Jobs::wait(rebuild_job);
+        rebuild_job.reset();
+        rebuilt.reset();
+
+        requested_settings = new_settings;
+        const uint32_t stages {spectrum ? get_invalidated_stages(spectrum->settings, new_settings) : 0u};
+        adopt_spectrum(build_spectrum(spectrum, new_settings, stages));
+    }
+
+    void Ocean::request_rebuild(const OceanSettings& new_settings) {
+        requested_settings = new_settings;
+        if (!rebuild_job) start_rebuild();
+    }
+
+    void Ocean::start_rebuild() {
+        // the base is the newest spectrum, so a rebuild only redoes what differs from it
+        rebuild_job = Jobs::submit([this, base = spectrum, target = requested_settings] {
+            Profiler::Scope scope("spectrum-rebuild", false);
+            rebuilt = build_spectrum(base, target, get_invalidated_stages(base->settings, target));
+        });
+    }
+
+    void Ocean::update() {
+        if (!rebuild_job || !Jobs::is_done(rebuild_job)) return;
+        rebuild_job.reset();
+        adopt_spectrum(std::move(rebuilt));
+
+        if (requested_settings != settings) start_rebuild();
+    }
+
+    void Ocean::adopt_spectrum(std::shared_ptr<const Spectrum> next) {
+        const size_t count {next->settings.resolution * next->settings.resolution};
+        // baked textures are half floats, so leaving playback recreates them like a resize
+        const bool resized {
+            next->settings.resolution != settings.resolution || next->settings.cascade_count != cascades.size() || bake ||
+            displacement_field.size() != next->settings.cascade_count * count
+        };
+
+        // a step in flight keeps the spectrum it started with, unless the buffers it writes are about to change size.
+        // that one is restarted on the new spectrum below
+        bool in_flight {false};
+        if (resized) {
+            in_flight = simulation_job != nullptr;
+            Jobs::wait(simulation_job);
+            simulation_job.reset();
+            bake.reset();
+        }
+
+        spectrum = std::move(next);
+        settings = spectrum->settings;
+
+        if (resized) {
+            reset_cascades();
+            // textures are created lazily on upload so the simulation also runs without a gl context
+            reset_textures();
+        }
+        schedule_cascades();
+
+        if (in_flight) begin_simulation(requested_time);
+    }
+
+    void Ocean::reset_cascades() {
+        const size_t count {settings.resolution * settings.resolution};
+        displacement_field.assign(settings.cascade_count * count, {});
+        slope_field.assign(settings.cascade_count * count, {});
+        height_field.assign(settings.cascade_count * count, {});
+
+        cascades.clear();
+        cascades.resize(settings.cascade_count);
+        for (Cascade& cascade : cascades) {
+            for (auto* data : {&cascade.displacement_data, &cascade.current_displacement_data, &cascade.previous_displacement_data}) data->assign(count, glm::vec4(0.f));
+            for (auto* data : {&cascade.slope_data, &cascade.current_slope_data, &cascade.previous_slope_data}) data->assign(count, glm::vec2(0.f));
+        }
+        stepped_cascades = 0;
+        uploaded_cascades = 0;
+    }
+
+    void Ocean::schedule_cascades() {
+        // periods are powers of two, so the whole schedule repeats after the longest one
+        uint32_t length {1};
+        for (size_t i {0}; i < cascades.size(); i++) {
+            cascades[i].period = bake ? 1u : std::bit_floor(std::clamp(settings.update_periods[i], 1u, OceanSettings::MAX_UPDATE_PERIOD));
+            length = std::max(length, cascades[i].period);
+        }
+        schedule_load.assign(length, 0);
+
+        // the most frequent cascades are placed first, each at the phase whose steps are least loaded so far
+        std::vector<size_t> order(cascades.size());
+        for (size_t i {0}; i < order.size(); i++) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return cascades[a].period < cascades[b].period; });
+
+        for (size_t i : order) {
+            Cascade& cascade = cascades[i];
+            uint32_t best_phase {0};
+            uint32_t best_peak {UINT32_MAX};
+            for (uint32_t phase {0}; phase < cascade.period; phase++) {
+                uint32_t peak {0};
+                for (uint32_t step {phase}; step < length; step += cascade.period) peak = std::max(peak, schedule_load[step]);
+                if (peak < best_peak) {
+                    best_peak = peak;
+                    best_phase = phase;
+                }
+            }
+
+            cascade.phase = best_phase;
+            for (uint32_t step {best_phase}; step < length; step += cascade.period) schedule_load[step]++;
+        }
+
+        fft_budget = *std::max_element(schedule_load.begin(), schedule_load.end());
+    }
+
+    uint32_t Ocean::get_rebuilt_stages() {
+        return spectrum ? spectrum->rebuilt_stages : 0u;
+    }
+
+    float Ocean::get_rebuild_ms() {
+        return spectrum ? spectrum->build_ms : 0.f;
+    }
+
+    bool Ocean::load_bake(const std::filesystem::path& path) {
+        std::unique_ptr<OceanBake> loaded = OceanBake::open(path);
+        if (!loaded) return false;
+
+        const bool in_flight {simulation_job != nullptr};
+        Jobs::wait(simulation_job);
+        simulation_job.reset();
+        Jobs::wait(rebuild_job);
+        rebuild_job.reset();
+        rebuilt.reset();
+
+        // the spectrum is left as it was, only what describes the frames changes
+        bake = std::move(loaded);
+        settings.resolution = bake->get_resolution();
+        settings.patch_size = bake->get_patch_size();
+        settings.cascade_count = bake->get_cascade_count();
+        settings.cascade_scale = bake->get_cascade_scale();
+        settings.loop_period = bake->get_period();
+        requested_settings = settings;
+
+        reset_cascades();
+        reset_textures();
+        schedule_cascades();
+
+        if (in_flight) begin_simulation(requested_time);
+        return true;
+    }
+
+    void Ocean::reset_textures() {
+        displacement_texture.reset();
+        slope_texture.reset();
+        foam_texture.reset();
+        stream.reset();
+        for (Cascade& cascade : cascades) {
+            cascade.uploads = 0;
+            cascade.states = 0;
+            cascade.layer = 0;
+            cascade.dirty = false;
+            cascade.displacement_allocation = {};
+            cascade.slope_allocation = {};
+        }
+    }
+
+    void Ocean::create_textures() {
+        if (displacement_texture) return;
+        const unsigned int layers {static_cast<unsigned int>(cascades.size() * 2)};
+
+        {
+            Texture::TextureCreateInfo create_info {GL_TEXTURE_2D_ARRAY};
+            create_info.width = settings.resolution;
+            create_info.height = settings.resolution;
+            create_info.layers = layers;
+            create_info.format = bake ? GL_RGBA16F : GL_RGBA32F;
+            create_info.filter = GL_LINEAR;
+            create_info.wrap = GL_REPEAT;
+            displacement_texture = std::make_unique<Texture>(create_info);
+        }
+
+        {
+            Texture::TextureCreateInfo create_info {GL_TEXTURE_2D_ARRAY};
+            create_info.width = settings.resolution;
+            create_info.height = settings.resolution;
+            create_info.layers = layers;
+            // a full chain, the fragments filter the slope down to their footprint instead of aliasing the short waves
+            create_info.levels = static_cast<unsigned int>(std::bit_width(settings.resolution));
+            create_info.format = bake ? GL_RG16F : GL_RG32F;
+            create_info.filter = GL_LINEAR_MIPMAP_LINEAR;
+            create_info.wrap = GL_REPEAT;
+            slope_texture = std::make_unique<Texture>(create_info);
+        }
+
+        {
+            Texture::TextureCreateInfo create_info {GL_TEXTURE_2D_ARRAY};
+            create_info.width = settings.resolution;
+            create_info.height = settings.resolution;
+            create_info.layers = layers;
+            create_info.format = GL_R16F;
+            create_info.filter = GL_LINEAR;
+            create_info.wrap = GL_REPEAT;
+            foam_texture = std::make_unique<Texture>(create_info);
+            // foam only ever accumulates from here
+            foam_texture->clear();
+        }
+
+        // baked frames are uploaded from the file mapping and need no staging
+        if (!bake) {
+            const size_t count {settings.resolution * settings.resolution};
+            stream = std::make_unique<StreamBuffer>(cascades.size() * (count * (sizeof(glm::vec4) + sizeof(glm::vec2)) + 512));
+        }
+    }
+
+    void Ocean::simulate(double time, bool every_cascade) {
+        begin_simulation(time, every_cascade);
+        finish_simulation();
+    }
+
+    void Ocean::begin_simulation(double time, bool every_cascade) {
+        finish_simulation();
+
+        if (bake) {
+            // the frame at or after `time`, counted without wrapping so state times keep increasing across the loop.
+            // decoding it for cpu queries on the workers also faults its pages in before the upload reads them
+            const double interval {bake->get_frame_interval()};
+            const double frame {std::max(0., std::ceil(time / interval - 1e-6))};
+            if (cascades[0].states > 0 && frame * interval == cascades[0].current_time) return;
+
+            requested_time = time;
+            pending_frame = static_cast<size_t>(std::fmod(frame, static_cast<double>(bake->get_frame_count())));
+            stepped_cascades = 0;
+            for (size_t i {0}; i < cascades.size(); i++) {
+                cascades[i].scheduled = true;
+                cascades[i].pending_time = frame * interval;
+                stepped_cascades |= 1u << i;
+            }
+
+            simulation_job = Jobs::submit([this, frame = pending_frame] {
+                Profiler::Scope scope("simulation-cpu", false);
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i {0}; i < cascades.size(); i++)
+                    bake->decode(frame, i, cascades[i].displacement_data.data(), cascades[i].slope_data.data());
+                simulation_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            });
+            return;
+        }
+
+        // the spacing of the requested times stands in for the clock's step when looking ahead
+        const double interval {schedule_step > 0 ? std::max(0., time - requested_time) : 0.};
+        const uint64_t slot {schedule_step++};
+        requested_time = time;
+
+        const size_t count {settings.resolution * settings.resolution};
+        if (stream) stream->begin_frame();
+
+        std::vector<StepTarget> targets;
+        stepped_cascades = 0;
+        for (size_t i {0}; i < cascades.size(); i++) {
+            Cascade& cascade = cascades[i];
+            // a cascade that has no state yet is stepped right away, at exactly `time`
+            const bool fresh {cascade.states == 0};
+            if (!every_cascade && !fresh && slot % cascade.period != cascade.phase) continue;
+
+            // it is next due `period` steps from now; until then the render time moves from the state before this one
+            // (at `time` - interval) to this one
+            const double look_ahead {every_cascade || fresh ? 0. : static_cast<double>(cascade.period - 1) * interval};
+            cascade.scheduled = true;
+            cascade.pending_time = time + look_ahead;
+            stepped_cascades |= 1u << i;
+
+            StepTarget target {i, static_cast<float>(cascade.pending_time), nullptr, nullptr};
+            if (stream) {
+                // the region is claimed on this thread, the workers only write through the mapping.
+                // a second step before the upload simply overwrites the region that is still open
+                if (!cascade.displacement_allocation.data) {
+                    cascade.displacement_allocation = stream->allocate(count * sizeof(glm::vec4));
+                    cascade.slope_allocation = stream->allocate(count * sizeof(glm::vec2));
+                }
+                if (cascade.displacement_allocation.data && cascade.slope_allocation.data) {
+                    target.mapped_displacement = static_cast<glm::vec4*>(cascade.displacement_allocation.data);
+                    target.mapped_slope = static_cast<glm::vec2*>(cascade.slope_allocation.data);
+                }
+                else cascade.displacement_allocation = {};
+            }
+            targets.push_back(target);
+        }
+        if (targets.empty()) return;
+
+        simulation_job = Jobs::submit([this, targets = std::move(targets), spectrum = spectrum, choppiness = settings.choppiness] {
+            Profiler::Scope scope("simulation-cpu", false);
+            step(*spectrum, choppiness, targets);
+        });
+    }
+
+    void Ocean::finish_simulation() {
+        if (!simulation_job) return;
+        Jobs::wait(simulation_job);
+        simulation_job.reset();
+        current_frame = pending_frame;
+
+        for (Cascade& cascade : cascades) {
+            if (!cascade.scheduled) continue;
+            cascade.scheduled = false;
+
+            std::swap(cascade.previous_displacement_data, cascade.current_displacement_data);
+            std::swap(cascade.previous_slope_data, cascade.current_slope_data);
+            std::swap(cascade.current_displacement_data, cascade.displacement_data);
+            std::swap(cascade.current_slope_data, cascade.slope_data);
+            cascade.previous_time = cascade.current_time;
+            cascade.current_time = cascade.pending_time;
+
+            // the first state after a rebuild is both the previous and the current one
+            if (cascade.states++ == 0) {
+                cascade.previous_displacement_data = cascade.current_displacement_data;
+                cascade.previous_slope_data = cascade.current_slope_data;
+                cascade.previous_time = cascade.current_time;
+            }
+            cascade.dirty = true;
+        }
+    }
+
+    void Ocean::step(const Spectrum& spectrum, float choppiness, const std::vector<StepTarget>& targets) {
+        auto start = std::chrono::steady_clock::now();
+        const size_t size {spectrum.settings.resolution};
+        const size_t count {size * size};
+        const std::vector<float>& k_x {spectrum.grid->k_x};
+        const std::vector<float>& k_z {spectrum.grid->k_z};
+        const std::vector<float>& omega {spectrum.dispersion->omega};
+        const std::vector<std::complex<float>>& h0 {spectrum.amplitudes->h0};
+        const std::vector<std::complex<float>>& h0_minus_conj {spectrum.amplitudes->h0_minus_conj};
+
+        // target j evolves into the j-th block of the fields, so all of them go through one batch of transforms
+        Jobs::parallel_for(targets.size() * size, 8, [&](size_t begin, size_t end) {
+            for (size_t row {begin}; row < end; row++) {
+                const StepTarget& target = targets[row / size];
+                const size_t field_offset {row / size * count};
+                const size_t spectrum_offset {target.cascade * count};
+
+                for (size_t i {row % size * size}; i < (row % size + 1) * size; i++) {
+                    const size_t s {spectrum_offset + i};
+                    const float phase = omega[s] * target.time;
+                    const std::complex<float> rotation(std::cos(phase), std::sin(phase));
+                    const std::complex<float> h = mul(h0[s], rotation) + mul(h0_minus_conj[s], std::conj(rotation));
+
+                    const float kx = k_x[s];
+                    const float kz = k_z[s];
+                    const float k = std::sqrt(kx * kx + kz * kz);
+                    const float inverse_k = k > 0.f ? 1.f / k : 0.f;
+
+                    // dx + i dz = -i k/|k| h, packed so both real fields come out of one transform
+                    displacement_field[field_offset + i] = mul(h, std::complex<float>(kz * inverse_k, -kx * inverse_k));
+                    // sx + i sz = i k h
+                    slope_field[field_offset + i] = mul(h, std::complex<float>(-kz, kx));
+                    height_field[field_offset + i] = h;
+                }
+            }
+        });
+
+        std::vector<std::complex<float>*> fields;
+        for (size_t j {0}; j < targets.size(); j++) {
+            fields.push_back(displacement_field.data() + j * count);
+            fields.push_back(slope_field.data() + j * count);
+            fields.push_back(height_field.data() + j * count);
+        }
+        inverse_fft_2d(fields.data(), fields.size(), size);
+
+        Jobs::parallel_for(targets.size() * size, 16, [&](size_t begin, size_t end) {
+            for (size_t row {begin}; row < end; row++) {
+                const StepTarget& target = targets[row / size];
+                Cascade& cascade = cascades[target.cascade];
+                const size_t field_offset {row / size * count};
+                const size_t first {row % size * size};
+
+                for (size_t i {first}; i < first + size; i++) {
+                    const size_t f {field_offset + i};
+                    cascade.displacement_data[i] = glm::vec4(
+                        choppiness * displacement_field[f].real(),
+                        height_field[f].real(),
+                        choppiness * displacement_field[f].imag(),
+                        0.f
+                    );
+                    cascade.slope_data[i] = glm::vec2(slope_field[f].real(), slope_field[f].imag());
+                }
+                // a straight copy of the row just written, the mapping is write-combined and never read
+                if (target.mapped_displacement) {
+                    std::copy(cascade.displacement_data.begin() + first, cascade.displacement_data.begin() + first + size, target.mapped_displacement + first);
+                    std::copy(cascade.slope_data.begin() + first, cascade.slope_data.begin() + first + size, target.mapped_slope + first);
+                }
+            }
+        });
+
+        simulation_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Ocean::upload() {
+        finish_simulation();
+        create_textures();
+        uploaded_cascades = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        bool streamed {false};
+        for (size_t i {0}; i < cascades.size(); i++) {
+            Cascade& cascade = cascades[i];
+            if (!cascade.dirty) continue;
+
+            cascade.layer ^= 1u;
+            cascade.upload_interval = cascade.uploads == 0 ? 0. : cascade.current_time - cascade.uploaded_time;
+            cascade.uploaded_time = cascade.current_time;
+
+            // the first state after (re)creating the textures is both the previous and the current one
+            for (size_t copy {0}; copy < (cascade.uploads == 0 ? 2 : 1); copy++) {
+                const uint32_t layer {copy == 0 ? get_current_layer(i) : get_previous_layer(i)};
+
+                if (bake) {
+                    displacement_texture->upload(bake->get_displacement(current_frame, i), GL_RGBA, GL_HALF_FLOAT, layer);
+                    slope_texture->upload(bake->get_slope(current_frame, i), GL_RG, GL_HALF_FLOAT, layer);
+                }
+                else if (cascade.displacement_allocation.data) {
+                    displacement_texture->upload(stream->get_id(), cascade.displacement_allocation.offset, GL_RGBA, GL_FLOAT, layer);
+                    slope_texture->upload(stream->get_id(), cascade.slope_allocation.offset, GL_RG, GL_FLOAT, layer);
+                }
+                else {
+                    displacement_texture->upload(cascade.current_displacement_data.data(), GL_RGBA, GL_FLOAT, layer);
+                    slope_texture->upload(cascade.current_slope_data.data(), GL_RG, GL_FLOAT, layer);
+                }
+            }
+
+            if (cascade.displacement_allocation.data) {
+                streamed = true;
+                cascade.displacement_allocation = {};
+                cascade.slope_allocation = {};
+            }
+            cascade.uploads++;
+            cascade.dirty = false;
+            uploaded_cascades |= 1u << i;
+        }
+        if (!uploaded_cascades) return;
+
+        slope_texture->generate_mipmaps();
+        if (streamed) stream->end_frame();
+        upload_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    float Ocean::get_interpolation(double time, size_t cascade) {
+        const Cascade& state = cascades[cascade];
+        if (state.current_time <= state.previous_time) return 1.f;
+        return static_cast<float>(std::clamp((time - state.previous_time) / (state.current_time - state.previous_time), 0., 1.));
+    }
+
+    WaveQuery::Field Ocean::get_query_field(bool previous, size_t cascade) {
+        const Cascade& state = cascades[cascade];
+        return WaveQuery::Field {
+            previous ? state.previous_displacement_data.data() : state.current_displacement_data.data(),
+            previous ? state.previous_slope_data.data() : state.current_slope_data.data(),
+            static_cast<uint32_t>(settings.resolution),
+            settings.get_patch_size(cascade)
+        };
+    }
+
+    void Ocean::query(const WaveQuery::Batch& batch, double time, size_t iterations) {
+        std::array<WaveQuery::Layer, OceanSettings::MAX_CASCADES> layers;
+        for (size_t i {0}; i < cascades.size(); i++)
+            layers[i] = WaveQuery::Layer {get_query_field(true, i), get_query_field(false, i), get_interpolation(time, i)};
+        WaveQuery::sample(std::span<const WaveQuery::Layer>(layers.data(), cascades.size()), batch, iterations);
+    }
+}
@@ -0,0 +1,237 @@
+#include "ocean_bake.h"
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "jobs.h"
+#include "utils.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace Engine::Game {
+    namespace {
+        // round to nearest even, overflow saturates to infinity
+        uint16_t float_to_half(float value) {
+            const uint32_t bits = std::bit_cast<uint32_t>(value);
+            const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+            const uint32_t magnitude = bits & 0x7fffffffu;
+
+            if (magnitude >= 0x7f800000u) return sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u);
+            if (magnitude >= 0x477ff000u) return sign | 0x7c00u;
+
+            uint32_t half, remainder, halfway;
+            if (magnitude < 0x38800000u) {
+                // below the smallest normal half: the implicit bit shifted into a subnormal mantissa
+                if (magnitude < 0x33000000u) return sign;
+                const uint32_t shift {126u - (magnitude >> 23)};
+                const uint32_t mantissa {(magnitude & 0x7fffffu) | 0x800000u};
+                half = mantissa >> shift;
+                remainder = mantissa & ((1u << shift) - 1u);
+                halfway = 1u << (shift - 1u);
+            }
+            else {
+                half = (magnitude - 0x38000000u) >> 13;
+                remainder = magnitude & 0x1fffu;
+                halfway = 0x1000u;
+            }
+
+            // a carry out of the mantissa correctly moves to the next exponent
+            if (remainder > halfway || (remainder == halfway && (half & 1u))) half++;
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        float half_to_float(uint16_t half) {
+            const uint32_t sign {(half & 0x8000u) << 16};
+            const uint32_t exponent {(half >> 10) & 0x1fu};
+            const uint32_t mantissa {half & 0x3ffu};
+
+            if (exponent == 0x1fu) return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+            if (exponent == 0u) {
+                const float value {static_cast<float>(mantissa) * 0x1p-24f};
+                return sign ? -value : value;
+            }
+            return std::bit_cast<float>(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+        }
+
+        size_t align(size_t value, size_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    bool OceanBake::write(const std::filesystem::path& path, const OceanSettings& settings, size_t frames) {
+        if (settings.loop_period <= 0.f || frames == 0) {
+            out_error("a bake needs a loop period and at least one frame");
+            return false;
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            out_error("failed to open {}", path.string());
+            return false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        const size_t texels {settings.resolution * settings.resolution};
+        const size_t frame_bytes {settings.cascade_count * texels * 6 * sizeof(uint16_t)};
+
+        Header header {};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.resolution = static_cast<uint32_t>(settings.resolution);
+        header.frame_count = static_cast<uint32_t>(frames);
+        header.cascade_count = static_cast<uint32_t>(settings.cascade_count);
+        header.patch_size = settings.patch_size;
+        header.cascade_scale = settings.cascade_scale;
+        header.period = settings.loop_period;
+        header.chunk_offset = align(sizeof(Header), CHUNK_ALIGNMENT);
+        header.chunk_stride = align(frame_bytes, CHUNK_ALIGNMENT);
+
+        std::vector<uint16_t> chunk(header.chunk_stride / sizeof(uint16_t), 0);
+        std::memcpy(chunk.data(), &header, sizeof(Header));
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(header.chunk_offset));
+
+        // no gl context is needed, the ocean only creates textures on upload
+        Ocean ocean(settings);
+
+        for (size_t frame {0}; frame < frames; frame++) {
+            // every frame holds every cascade at exactly its time, the playback has no schedule to look ahead for
+            ocean.simulate(static_cast<double>(frame) * settings.loop_period / frames, true);
+
+            for (size_t cascade {0}; cascade < settings.cascade_count; cascade++) {
+                const WaveQuery::Field field = ocean.get_query_field(false, cascade);
+                uint16_t* displacement {chunk.data() + cascade * texels * 6};
+                uint16_t* slope {displacement + texels * 4};
+
+                Jobs::parallel_for(texels, 4096, [&](size_t begin, size_t end) {
+                    for (size_t i {begin}; i < end; i++) {
+                        for (size_t c {0}; c < 4; c++) displacement[i * 4 + c] = float_to_half(field.displacement[i][c]);
+                        for (size_t c {0}; c < 2; c++) slope[i * 2 + c] = float_to_half(field.slope[i][c]);
+                    }
+                });
+            }
+
+            file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(header.chunk_stride));
+        }
+
+        if (!file.good()) {
+            out_error("failed to write {}", path.string());
+            return false;
+        }
+
+        const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+        out("baked {} frames of {} x {}^2 over {:.2f} s into {} ({:.1f} MiB) in {:.2f} s",
+            frames, settings.cascade_count, settings.resolution, settings.loop_period, path.string(),
+            (header.chunk_offset + frames * header.chunk_stride) / 1048576., seconds);
+        return true;
+    }
+
+    std::unique_ptr<OceanBake> OceanBake::open(const std::filesystem::path& path) {
+        std::unique_ptr<OceanBake> bake(new OceanBake());
+        bake->path = path;
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            out_error("failed to open {}", path.string());
+            return nullptr;
+        }
+        bake->file = file;
+
+        LARGE_INTEGER size {};
+        GetFileSizeEx(file, &size);
+        bake->mapping_size = static_cast<size_t>(size.QuadPart);
+
+        bake->file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (bake->file_mapping) bake->mapping = static_cast<const std::byte*>(MapViewOfFile(bake->file_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        bake->file = ::open(path.c_str(), O_RDONLY);
+        if (bake->file < 0) {
+            out_error("failed to open {}", path.string());
+            return nullptr;
+        }
+
+        struct stat status {};
+        fstat(bake->file, &status);
+        bake->mapping_size = static_cast<size_t>(status.st_size);
+
+        if (bake->mapping_size > 0) {
+            void* mapping = mmap(nullptr, bake->mapping_size, PROT_READ, MAP_SHARED, bake->file, 0);
+            if (mapping != MAP_FAILED) bake->mapping = static_cast<const std::byte*>(mapping);
+        }
+#endif
+
+        if (!bake->mapping || bake->mapping_size < sizeof(Header)) {
+            out_error("failed to map {}", path.string());
+            return nullptr;
+        }
+
+        Header& header = bake->header;
+        std::memcpy(&header, bake->mapping, sizeof(Header));
+
+        // every product below is checked through a division instead, so a crafted header cannot wrap past the file size
+        const size_t texels {static_cast<size_t>(header.resolution) * header.resolution};
+        const bool valid {
+            std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+            header.version == VERSION &&
+            header.frame_count > 0 &&
+            header.cascade_count > 0 && header.cascade_count <= OceanSettings::MAX_CASCADES &&
+            std::has_single_bit(header.resolution) &&
+            header.period > 0.f &&
+            header.chunk_stride > 0 &&
+            header.chunk_stride / (header.cascade_count * 6 * sizeof(uint16_t)) >= texels &&
+            header.chunk_offset <= bake->mapping_size &&
+            header.frame_count <= (bake->mapping_size - header.chunk_offset) / header.chunk_stride
+        };
+        if (!valid) {
+            out_error("{} is not a valid ocean bake", path.string());
+            return nullptr;
+        }
+
+        out("ocean bake {}: {} frames of {} x {}^2, period {:.2f} s", path.string(), header.frame_count, header.cascade_count, header.resolution, header.period);
+        return bake;
+    }
+
+    OceanBake::~OceanBake() {
+#if defined(_WIN32)
+        if (mapping) UnmapViewOfFile(mapping);
+        if (file_mapping) CloseHandle(file_mapping);
+        if (file) CloseHandle(file);
+#else
+        if (mapping) munmap(const_cast<std::byte*>(mapping), mapping_size);
+        if (file >= 0) close(file);
+#endif
+    }
+
+    const uint16_t* OceanBake::get_displacement(size_t frame, size_t cascade) const {
+        const size_t texels {static_cast<size_t>(header.resolution) * header.resolution};
+        const size_t offset {header.chunk_offset + (frame % header.frame_count) * header.chunk_stride};
+        return reinterpret_cast<const uint16_t*>(mapping + offset) + cascade * texels * 6;
+    }
+
+    const uint16_t* OceanBake::get_slope(size_t frame, size_t cascade) const {
+        return get_displacement(frame, cascade) + static_cast<size_t>(header.resolution) * header.resolution * 4;
+    }
+
+    void OceanBake::decode(size_t frame, size_t cascade, glm::vec4* displacement, glm::vec2* slope) const {
+        const uint16_t* displacement_in {get_displacement(frame, cascade)};
+        const uint16_t* slope_in {get_slope(frame, cascade)};
+        const size_t texels {static_cast<size_t>(header.resolution) * header.resolution};
+
+        Jobs::parallel_for(texels, 4096, [&](size_t begin, size_t end) {
+            for (size_t i {begin}; i < end; i++) {
+                for (size_t c {0}; c < 4; c++) displacement[i][c] = half_to_float(displacement_in[i * 4 + c]);
+                for (size_t c {0}; c < 2; c++) slope[i][c] = half_to_float(slope_in[i * 2 + c]);
+            }
+        });
+    }
+}
@@ -1,17 +1,52 @@
 #include "renderer.h"
+#include <array>
+#include <numbers>
 
 namespace Engine::Game {
-    std::unique_ptr<Texture> texture_framebuffer_color;
-    std::unique_ptr<Texture> texture_framebuffer_depth;
-    std::unique_ptr<FBO> framebuffer;
-    std::unique_ptr<VAO> vao;
-    std::unique_ptr<Buffer> vbo;
-    std::unique_ptr<Buffer> ebo;
-    Mesh mesh_plane;
+    std::unique_ptr<RenderTargetPool> render_targets;
+    std::unique_ptr<FrameGraph> frame_graph;
+    std::unique_ptr<VAO> fullscreen_vao;
+    Texture* texture_framebuffer_color {nullptr};
+    // the temporal pass reads one and writes the other, they swap every frame
+    std::array<Texture*, 2> texture_history {};
+    std::unique_ptr<Clipmap> clipmap;
+    std::unique_ptr<Ocean> ocean;
+    std::unique_ptr<Buoyancy> buoyancy;
+    std::unique_ptr<UBO> frame_uniforms;
+
+    // targets that outlive a frame are bucket sized; only a viewport that leaves its bucket (or shrinks to a quarter of it)
+    // gets a new one. every other target is a frame graph transient and follows the viewport on its own
+    void fit_persistent_target(Texture*& texture, GLenum format, glm::uvec2 size) {
+        if (texture) {
+            const glm::uvec2 capacity(texture->get_width(), texture->get_height());
+            const glm::uvec2 bucket = RenderTargetPool::bucket_size(size);
+            if (glm::all(glm::greaterThanEqual(capacity, size)) && capacity.x * capacity.y <= 4u * bucket.x * bucket.y) return;
+            render_targets->release(texture);
+        }
+        texture = render_targets->acquire({format, size});
+    }
+
+    void resize_framebuffer(glm::uvec2 size) {
+        fit_persistent_target(texture_framebuffer_color, GL_RGB8, size);
+        for (Texture*& history : texture_history) fit_persistent_target(history, GL_RGBA16F, size);
+    }
+
+    // radical inverse of `index` in `base`, low discrepancy sub-pixel offsets for the jitter
+    float halton(size_t index, size_t base) {
+        float fraction {1.f};
+        float result {0.f};
+        for (; index > 0; index /= base) {
+            fraction /= static_cast<float>(base);
+            result += fraction * static_cast<float>(index % base);
+        }
+        return result;
+    }
 
     Renderer::Renderer(float width, float height) {        
         //SHADER-INIT
         {
+            auto shader_start = std::chrono::steady_clock::now();
+
             shaders["default"] = Shader(
                 ASSETS_DIR "shaders/default/vert.glsl",
                 ASSETS_DIR "shaders/default/frag.glsl"
@@ -21,83 +56,70 @@ namespace Engine::Game {
                 ASSETS_DIR "shaders/ocean/vert.glsl",
                 ASSETS_DIR "shaders/ocean/frag.glsl"
             );
-        }
 
-        //FRAMEBUFFER-INIT
-        {
-            framebuffer = std::make_unique<FBO>();
-        
-            {
-                Texture::TextureCreateInfo create_info {GL_TEXTURE_2D};
-                create_info.width = width;
-                create_info.height = height;
-                create_info.format = GL_RGB8;
-                create_info.filter = GL_LINEAR;
-                create_info.wrap = GL_CLAMP_TO_EDGE;
-                texture_framebuffer_color = std::make_unique<Texture>(create_info);
-            }
+            shaders["bodies"] = Shader(
+                ASSETS_DIR "shaders/buoyancy/vert.glsl",
+                ASSETS_DIR "shaders/buoyancy/frag.glsl"
+            );
 
-            {
-                Texture::TextureCreateInfo create_info {GL_TEXTURE_2D};
-                create_info.width = width;
-                create_info.height = height;
-                create_info.format = GL_DEPTH_COMPONENT24;
-                create_info.filter = GL_LINEAR;
-                create_info.wrap = GL_CLAMP_TO_EDGE;
-                texture_framebuffer_depth = std::make_unique<Texture>(create_info);  
-            }
+            shaders["sky"] = Shader(
+                ASSETS_DIR "shaders/fullscreen/vert.glsl",
+                ASSETS_DIR "shaders/sky/frag.glsl"
+            );
+
+            shaders["post"] = Shader(
+                ASSETS_DIR "shaders/fullscreen/vert.glsl",
+                ASSETS_DIR "shaders/post/frag.glsl"
+            );
+
+            shaders["temporal"] = Shader(
+                ASSETS_DIR "shaders/fullscreen/vert.glsl",
+                ASSETS_DIR "shaders/temporal/frag.glsl"
+            );
+
+            shaders["foam"] = Shader(ASSETS_DIR "shaders/foam/comp.glsl");
+
+            // every program is submitted before the first one is waited on, so the driver can compile them side by side
+            for (auto& shader : shaders) shader.second.finish();
 
-            framebuffer->attach(GL_COLOR_ATTACHMENT0, texture_framebuffer_color.get());
-            framebuffer->attach(GL_DEPTH_ATTACHMENT, texture_framebuffer_depth.get());
-            framebuffer->set_draw_buffers({ GL_COLOR_ATTACHMENT0 });
-            framebuffer->status();
+            shader_startup_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shader_start).count();
+            Shader::CacheStatistics cache = Shader::get_cache_statistics();
+            out("shaders ready in {:.2f} ms ({} start, {} cached, {} compiled)", shader_startup_ms, cache.misses ? "cold" : "warm", cache.hits, cache.misses);
+
+            shader_watcher = std::make_unique<FileWatcher>();
+            watch_shaders();
         }
-        
-        //PLANE-INIT
-        {
 
-            constexpr size_t SIZE { 20 };
-            constexpr size_t HALF_SIZE { SIZE / 2 };
-            constexpr size_t RESOLUTION { 4 };
-            constexpr size_t REAL_SIZE { SIZE * RESOLUTION };
-                     
-            for (size_t z {0}; z <= REAL_SIZE; z++) {
-                for (size_t x {0}; x <= REAL_SIZE; x++) {
-                    float _x = static_cast<float>(x)/RESOLUTION;
-                    float _z = static_cast<float>(z)/RESOLUTION;
-                    
-                    mesh_plane.vertices.push_back(Vertex {
-                        glm::vec3{_x - HALF_SIZE, 0, _z - HALF_SIZE}
-                    });
-                }
-            }
+        //FRAMEBUFFER-INIT
+        {
+            render_targets = std::make_unique<RenderTargetPool>();
+            frame_graph = std::make_unique<FrameGraph>(*render_targets);
+            fullscreen_vao = std::make_unique<VAO>();
+            viewport_size = glm::uvec2(width, height);
+            resize_framebuffer(viewport_size);
+        }
 
-            for (size_t z {0}; z < REAL_SIZE; z++) {
-                for (size_t x {0}; x < REAL_SIZE; x++) {
-                    uint32_t topLeft     = z * (REAL_SIZE + 1) + x;
-                    uint32_t topRight    = topLeft + 1;
-                    uint32_t bottomLeft  = topLeft + (REAL_SIZE + 1);
-                    uint32_t bottomRight = bottomLeft + 1;
+        //UNIFORM-INIT
+        {
+            frame_uniforms = std::make_unique<UBO>(sizeof(FrameData));
+            frame_uniforms->bind(Shader::FRAME_BLOCK_BINDING);
+        }
 
-                    mesh_plane.indices.push_back(topLeft);
-                    mesh_plane.indices.push_back(bottomLeft);
-                    mesh_plane.indices.push_back(topRight);
+        //CLIPMAP-INIT
+        {
+            clipmap = std::make_unique<Clipmap>(ClipmapSettings {});
+        }
 
-                    mesh_plane.indices.push_back(topRight);
-                    mesh_plane.indices.push_back(bottomLeft);
-                    mesh_plane.indices.push_back(bottomRight);;
-                }
-            }
+        //OCEAN-INIT
+        {
+            ocean = std::make_unique<Ocean>(OceanSettings {});
+            // the simulation always runs one step ahead of the clock, see render_scene
+            ocean->begin_simulation(clock.get_time() + clock.get_timestep());
+        }
 
-            vao = std::make_unique<VAO>();
-            vbo = std::make_unique<Buffer>();
-            ebo = std::make_unique<Buffer>();
-        
-            vbo->data(mesh_plane.vertices.data(), mesh_plane.vertices.size() * sizeof(Vertex));
-            ebo->data(mesh_plane.indices.data(), mesh_plane.indices.size() * sizeof(uint32_t));
-            
-            vao->attrib(0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
-            vao->bind_buffers(vbo->get_id(), ebo->get_id());            
+        //BUOYANCY-INIT
+        {
+            buoyancy = std::make_unique<Buoyancy>(BuoyancySettings {});
         }
 
         //GL-INIT
@@ -109,17 +131,35 @@ namespace Engine::Game {
             glEnable(GL_BLEND);  
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  
             glClearColor(.12f, .12f, .12f, 1.f);
-            glViewport(0, 0, width, height);
         }
     
         //ENGINE-INIT
         {
-            camera = std::make_unique<Camera>(width, height, CameraMode::Orbit, 70.f);
+            camera = std::make_unique<Camera>(width, height, CameraMode::Orbit, 70.f, .1f, 5000.f);
         }
     }
         
+    // the job pool is a function local static created after these globals, so it would be torn down before them: the
+    // ocean's jobs in flight have to be waited on while it is still alive, and the gl objects freed while the context is
+    Renderer::~Renderer() {
+        buoyancy.reset();
+        ocean.reset();
+        clipmap.reset();
+    }
+
     void Renderer::update(GLFWwindow* window, float delta_time) {
+        render_targets->new_frame();
         camera->update(window, delta_time);
+        clipmap->update(camera->position);
+        // a spectrum rebuilt on the workers takes over here, before this frame's graph imports the ocean textures
+        ocean->update();
+        simulation_steps = clock.advance(delta_time);
+
+        // bodies step with the clock against the cpu copies of the displayed states, while the next state is still on the workers
+        for (size_t step {0}; step < simulation_steps; step++) {
+            const double step_time = clock.get_time() - static_cast<double>(simulation_steps - 1 - step) * clock.get_timestep();
+            buoyancy->step(*ocean, step_time, static_cast<float>(clock.get_timestep()));
+        }
 
         if (Input::is_key_pressed(GLFW_KEY_X)) {
             static bool show_polygon {false};
@@ -129,16 +169,64 @@ namespace Engine::Game {
 
         if (Input::is_key_pressed(GLFW_KEY_R)) {
             for (auto& shader : shaders) {
-                shader.second.reload();
+                pending_shaders.insert_or_assign(shader.first, shader.second.recompile());
             }
-            out("shaders reloaded ...");
+            out("shaders reloading ...");
         }
+
+        update_shaders();
+    }
+
+    void Renderer::watch_shaders() {
+        shader_dependents.clear();
+        for (auto& [name, shader] : shaders) {
+            for (const std::filesystem::path& file : shader.get_dependencies()) {
+                shader_dependents[file].insert(name);
+                shader_watcher->watch(file);
+            }
+        }
+    }
+
+    void Renderer::update_shaders() {
+        for (const std::filesystem::path& file : shader_watcher->poll_changes()) {
+            auto dependents = shader_dependents.find(file);
+            if (dependents == shader_dependents.end()) continue;
+
+            // a newer edit replaces a rebuild that is still in flight
+            for (const std::string& name : dependents->second)
+                pending_shaders.insert_or_assign(name, shaders[name].recompile());
+        }
+
+        bool swapped {false};
+        for (auto it = pending_shaders.begin(); it != pending_shaders.end();) {
+            if (!it->second.is_ready()) { ++it; continue; }
+
+            if (it->second.is_linked()) {
+                shaders[it->first] = std::move(it->second);
+                out("shader '{}' reloaded", it->first);
+                swapped = true;
+            }
+            else out_error("shader '{}' kept its previous program", it->first);
+
+            it = pending_shaders.erase(it);
+        }
+
+        // a successful edit may have added or dropped includes
+        if (swapped) watch_shaders();
     }
 
     void draw_imgui_information_header(Camera* camera) {
         if (ImGui::CollapsingHeader("information", ImGuiTreeNodeFlags_DefaultOpen)) {
-            ImGui::Text(std::format("fps: {}", 1.f / Time::Timer::delta_time).c_str());
+            Profiler::Statistics frame = Profiler::get_cpu_statistics("frame");
+            ImGui::Text(std::format("frame: {:.2f} ms avg, {:.2f} ms p99 ({:.0f} fps)", frame.average, frame.p99, frame.average > 0.f ? 1000.f / frame.average : 0.f).c_str());
             ImGui::Text(std::format("eye: {}", camera_position_to_string_view(camera).data()).c_str());
+            Shader::CacheStatistics cache = Shader::get_cache_statistics();
+            ImGui::Text(std::format("shader cache: {} hits, {} misses", cache.hits, cache.misses).c_str());
+            ImGui::Text(std::format("render targets: {} textures, {:.1f} MiB, {} allocations", render_targets->get_texture_count(), render_targets->get_allocated_bytes() / 1048576., render_targets->get_allocation_count()).c_str());
+            if (ImGui::TreeNode("profiler")) {
+                Profiler::draw_imgui();
+                ImGui::TreePop();
+            }
         }
     }
 
@@ -158,10 +246,256 @@ namespace Engine::Game {
 
     }
 
-    void draw_imgui_ocean_settings_header() {
-        if (ImGui::CollapsingHeader("ocean-settings", ImGuiTreeNodeFlags_DefaultOpen)) {}
+    void draw_imgui_ocean_settings_header(Ocean* ocean, double time) {
+        if (ImGui::CollapsingHeader("ocean-settings", ImGuiTreeNodeFlags_DefaultOpen)) {
+            // the sliders follow the requested settings, the active ones catch up once the workers have rebuilt the spectrum
+            OceanSettings settings = ocean->get_requested_settings();
+            bool changed {false};
+
+            if (ImGui::BeginCombo("spectrum", ocean_spectrum_to_string_view(settings.spectrum).data())) {
+                for (auto& spectrum : {OceanSpectrum::Phillips, OceanSpectrum::Jonswap}) {
+                    bool is_selected = spectrum == settings.spectrum;
+                    if (ImGui::Selectable(ocean_spectrum_to_string_view(spectrum).data(), is_selected)) {
+                        settings.spectrum = spectrum;
+                        changed = true;
+                    }
+                    if (is_selected) ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            if (ImGui::BeginCombo("resolution", std::format("{}", settings.resolution).c_str())) {
+                for (size_t resolution : {64, 128, 256, 512}) {
+                    bool is_selected = resolution == settings.resolution;
+                    if (ImGui::Selectable(std::format("{}", resolution).c_str(), is_selected)) {
+                        settings.resolution = resolution;
+                        changed = true;
+                    }
+                    if (is_selected) ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            changed |= ImGui::SliderFloat("patch-size", &settings.patch_size, 8.f, 2048.f, "%.1f m", ImGuiSliderFlags_Logarithmic);
+            int cascade_count = static_cast<int>(settings.cascade_count);
+            if (ImGui::SliderInt("cascades", &cascade_count, 1, static_cast<int>(OceanSettings::MAX_CASCADES))) {
+                settings.cascade_count = static_cast<size_t>(cascade_count);
+                changed = true;
+            }
+            if (settings.cascade_count > 1)
+                changed |= ImGui::SliderFloat("cascade-scale", &settings.cascade_scale, 2.f, 16.f, "%.1fx");
+            changed |= ImGui::SliderFloat("wind-speed", &settings.wind_speed, .5f, 40.f);
+            changed |= ImGui::SliderFloat("wind-direction", &settings.wind_direction, 0.f, 360.f);
+            if (settings.spectrum == OceanSpectrum::Jonswap)
+                changed |= ImGui::SliderFloat("fetch", &settings.fetch, 1000.f, 500000.f, "%.0f", ImGuiSliderFlags_Logarithmic);
+            changed |= ImGui::SliderFloat("depth", &settings.depth, 1.f, 1000.f, "%.1f m", ImGuiSliderFlags_Logarithmic);
+            changed |= ImGui::SliderFloat("spread", &settings.spread, .25f, 32.f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            changed |= ImGui::SliderFloat("amplitude", &settings.amplitude, 0.f, 4.f);
+            changed |= ImGui::SliderFloat("choppiness", &settings.choppiness, 0.f, 2.f);
+            int seed = static_cast<int>(settings.seed);
+            if (ImGui::InputInt("seed", &seed)) {
+                settings.seed = static_cast<uint32_t>(seed);
+                changed = true;
+            }
+            changed |= ImGui::SliderFloat("loop-period", &settings.loop_period, 0.f, 120.f, settings.loop_period > 0.f ? "%.1f s" : "off");
+
+            if (changed) ocean->request_rebuild(settings);
+
+            const uint32_t stages {ocean->get_rebuilt_stages()};
+            std::string rebuilt;
+            for (auto [stage, name] : {std::pair {Ocean::STAGE_GRID, "grid"}, {Ocean::STAGE_NOISE, "noise"}, {Ocean::STAGE_DISPERSION, "dispersion"}, {Ocean::STAGE_AMPLITUDES, "amplitudes"}})
+                if (stages & stage) rebuilt += rebuilt.empty() ? name : std::format(", {}", name);
+            ImGui::Text(std::format("spectrum: {} ({} in {:.2f} ms)", ocean->is_rebuilding() ? "rebuilding" : "ready", rebuilt.empty() ? "nothing" : rebuilt, ocean->get_rebuild_ms()).c_str());
+
+            // any edit above returns to the live simulation
+            if (const OceanBake* bake = ocean->get_bake())
+                ImGui::Text(std::format("baked: {} ({} frames, {:.1f} MiB mapped)", bake->get_path().filename().string(), bake->get_frame_count(), bake->get_file_bytes() / 1048576.).c_str());
+
+            // periods are edited on the requested settings too, but rebuild nothing and take effect with the next adoption
+            if (ImGui::TreeNodeEx("cascades", ImGuiTreeNodeFlags_DefaultOpen)) {
+                for (size_t i {0}; i < settings.cascade_count; i++) {
+                    ImGui::PushID(static_cast<int>(i));
+                    const uint32_t period {settings.update_periods[i]};
+                    if (ImGui::BeginCombo("update-period", std::format("every {} steps", period).c_str())) {
+                        for (uint32_t candidate {1}; candidate <= OceanSettings::MAX_UPDATE_PERIOD; candidate *= 2) {
+                            bool is_selected = candidate == period;
+                            if (ImGui::Selectable(std::format("every {} steps", candidate).c_str(), is_selected)) {
+                                settings.update_periods[i] = candidate;
+                                ocean->request_rebuild(settings);
+                            }
+                            if (is_selected) ImGui::SetItemDefaultFocus();
+                        }
+                        ImGui::EndCombo();
+                    }
+                    ImGui::PopID();
+
+                    if (i >= ocean->get_cascade_count()) continue;
+                    // the band in wavelengths, clamped to what the tile can hold at either end
+                    const OceanSettings& active = ocean->get_settings();
+                    const float tile {active.get_patch_size(i)};
+                    const float longest {std::min(tile, 2.f * std::numbers::pi_v<float> / active.get_band_start(i))};
+                    const float shortest {std::max(2.f * tile / active.resolution, 2.f * std::numbers::pi_v<float> / active.get_band_start(i + 1))};
+                    ImGui::Text(std::format("{}: {:.1f} m tile, waves {:.2f} - {:.2f} m, phase {}{}", i, tile, longest, shortest,
+                        ocean->get_update_phase(i), ocean->get_stepped_cascades() & (1u << i) ? ", stepped" : "").c_str());
+                }
+
+                std::string load;
+                for (uint32_t cascades : ocean->get_schedule_load()) load += std::format("{} ", cascades);
+                ImGui::Text(std::format("fft budget: {} cascades per step (schedule {})", ocean->get_fft_budget(), load).c_str());
+                ImGui::TreePop();
+            }
+
+            ImGui::Text(std::format("simulation: {:.2f} ms ({} workers)", ocean->get_simulation_ms(), Jobs::get_worker_count()).c_str());
+            ImGui::Text(std::format("upload: {:.2f} ms", ocean->get_upload_ms()).c_str());
+
+            static double query_ms {0.};
+            if (ImGui::Button("benchmark cpu query")) {
+                constexpr size_t POINTS {65536};
+                std::vector<float> x(POINTS), z(POINTS), results[6];
+                for (auto& result : results) result.resize(POINTS);
+                for (size_t i {0}; i < POINTS; i++) {
+                    x[i] = static_cast<float>(i % 256) * .37f;
+                    z[i] = static_cast<float>(i / 256) * .37f;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                ocean->query(WaveQuery::Batch {x, z, results[0], results[1], results[2], results[3], results[4], results[5]}, time);
+                query_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            ImGui::SameLine();
+            ImGui::Text(std::format("65536 points: {:.2f} ms ({})", query_ms, WaveQuery::isa_to_string_view(WaveQuery::get_isa())).c_str());
+        }
     }
     
+    void draw_imgui_simulation_clock_header(Time::SimulationClock& clock) {
+        if (ImGui::CollapsingHeader("simulation-clock")) {
+            float rate = static_cast<float>(1. / clock.get_timestep());
+            int max_steps = static_cast<int>(clock.get_max_steps());
+
+            if (ImGui::SliderFloat("rate (hz)", &rate, 10.f, 240.f, "%.0f")) clock.set_timestep(1. / rate);
+            if (ImGui::SliderInt("max-catch-up", &max_steps, 1, 16)) clock.set_max_steps(static_cast<size_t>(max_steps));
+
+            ImGui::Text(std::format("step {} at {:.3f} s, alpha {:.2f}", clock.get_step(), clock.get_time(), clock.get_alpha()).c_str());
+            ImGui::Text(std::format("dropped: {:.3f} s", clock.get_dropped_time()).c_str());
+        }
+    }
+
+    void draw_imgui_buoyancy_header(Buoyancy* buoyancy) {
+        if (ImGui::CollapsingHeader("buoyancy")) {
+            BuoyancySettings settings = buoyancy->get_settings();
+            int count = static_cast<int>(settings.count);
+            bool changed {false};
+
+            changed |= ImGui::SliderInt("bodies", &count, 0, 16384);
+            changed |= ImGui::SliderFloat("density", &settings.density, 100.f, 1500.f);
+            changed |= ImGui::SliderFloat("spacing", &settings.spacing, 1.f, 16.f);
+            if (ImGui::Button("respawn")) changed = true;
+
+            if (changed) {
+                settings.count = static_cast<size_t>(count);
+                buoyancy->rebuild(settings);
+            }
+
+            // hull points go through the same batched query as the benchmark in ocean-settings
+            ImGui::Text(std::format("step: {:.2f} ms for {} hull points", buoyancy->get_step_ms(), buoyancy->get_count() * Buoyancy::HULL_POINTS).c_str());
+        }
+    }
+
+    void draw_imgui_clipmap_header(Clipmap* clipmap) {
+        if (ImGui::CollapsingHeader("clipmap", ImGuiTreeNodeFlags_DefaultOpen)) {
+            ClipmapSettings settings = clipmap->get_settings();
+            int grid_size = static_cast<int>(settings.grid_size);
+            int levels = static_cast<int>(settings.levels);
+            bool changed {false};
+
+            changed |= ImGui::SliderInt("grid-size", &grid_size, 16, 256);
+            changed |= ImGui::SliderInt("levels", &levels, 1, 16);
+            changed |= ImGui::SliderFloat("cell-size", &settings.cell_size, .05f, 4.f);
+
+            if (ImGui::BeginCombo("index-layout", grid_layout_to_string_view(settings.layout).data())) {
+                for (auto layout : {GridMeshBuilder::Layout::RowMajor, GridMeshBuilder::Layout::VertexCache, GridMeshBuilder::Layout::Strips}) {
+                    bool is_selected = layout == settings.layout;
+                    if (ImGui::Selectable(grid_layout_to_string_view(layout).data(), is_selected)) {
+                        settings.layout = layout;
+                        changed = true;
+                    }
+                    if (is_selected) ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            if (changed) {
+                settings.grid_size = static_cast<size_t>(grid_size);
+                settings.levels = static_cast<size_t>(levels);
+                clipmap->rebuild(settings);
+            }
+
+            if (ImGui::BeginTable("clipmap-levels", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("level");
+                ImGui::TableSetupColumn("cell-size");
+                ImGui::TableSetupColumn("vertices");
+                ImGui::TableSetupColumn("triangles");
+                ImGui::TableSetupColumn("acmr");
+                ImGui::TableHeadersRow();
+
+                size_t total_vertices {0};
+                for (size_t level {0}; level < clipmap->get_levels().size(); level++) {
+                    total_vertices += clipmap->get_level_vertex_count(level);
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text(std::format("{}", level).c_str());
+                    ImGui::TableNextColumn(); ImGui::Text(std::format("{:.2f} m", clipmap->get_levels()[level].cell_size).c_str());
+                    ImGui::TableNextColumn(); ImGui::Text(std::format("{}", clipmap->get_level_vertex_count(level)).c_str());
+                    ImGui::TableNextColumn(); ImGui::Text(std::format("{}", clipmap->get_level_triangle_count(level)).c_str());
+                    ImGui::TableNextColumn(); ImGui::Text(std::format("{:.3f}", clipmap->get_level_report(level).acmr).c_str());
+                }
+                ImGui::EndTable();
+
+                const ClipmapSettings& current = clipmap->get_settings();
+                float extent = current.grid_size * current.cell_size * std::exp2(static_cast<float>(current.levels - 1));
+                ImGui::Text(std::format("total: {} vertices, extent {:.0f} m", total_vertices, extent).c_str());
+                ImGui::Text(std::format("indices: {:.1f} KiB, no vertex buffer", clipmap->get_index_bytes() / 1024.).c_str());
+            }
+        }
+    }
+
+    void draw_imgui_foam_header(FoamSettings& settings) {
+        if (ImGui::CollapsingHeader("foam")) {
+            ImGui::Checkbox("enabled", &settings.enabled);
+            ImGui::SliderFloat("threshold", &settings.threshold, 0.f, 1.5f);
+            ImGui::SliderFloat("lifetime (s)", &settings.lifetime, .05f, 10.f, "%.2f", ImGuiSliderFlags_Logarithmic);
+
+            Profiler::Statistics pass = Profiler::get_gpu_statistics("foam");
+            ImGui::Text(std::format("pass: {:.3f} ms avg, {:.3f} ms p99", pass.average, pass.p99).c_str());
+        }
+    }
+
+    void draw_imgui_render_scale_header(RenderScaleSettings& settings, float scale, float scaled_pass_ms, glm::uvec2 scene_size, glm::uvec2 viewport_size) {
+        if (ImGui::CollapsingHeader("render scale")) {
+            ImGui::Checkbox("dynamic", &settings.dynamic);
+            if (settings.dynamic) {
+                ImGui::SliderFloat("target (ms)", &settings.target_ms, 1.f, 50.f, "%.1f");
+                ImGui::SliderFloat("min-scale", &settings.min_scale, .25f, 1.f);
+                ImGui::SliderFloat("max-scale", &settings.max_scale, .25f, 1.f);
+                settings.max_scale = std::max(settings.max_scale, settings.min_scale);
+            }
+            else ImGui::SliderFloat("scale", &settings.scale, .25f, 1.f);
+
+            ImGui::Checkbox("temporal", &settings.temporal);
+            if (settings.temporal) ImGui::SliderFloat("history-weight", &settings.history_weight, 0.f, .98f);
+
+            Profiler::Statistics resolve = Profiler::get_gpu_statistics("temporal");
+            ImGui::Text(std::format("scale: {:.2f}, {} x {} of {} x {}", scale, scene_size.x, scene_size.y, viewport_size.x, viewport_size.y).c_str());
+            ImGui::Text(std::format("scaled passes: {:.3f} ms", scaled_pass_ms).c_str());
+            if (settings.temporal) ImGui::Text(std::format("temporal pass: {:.3f} ms avg", resolve.average).c_str());
+        }
+    }
+
+    void draw_imgui_frame_graph_header(FrameGraph* graph) {
+        if (ImGui::CollapsingHeader("frame graph")) {
+            graph->draw_imgui();
+        }
+    }
+
     void draw_imgui_graph_preview_header() {
         static double timer = 0.f;
         timer += Time::Timer::delta_time;
@@ -170,25 +504,28 @@ namespace Engine::Game {
 
         constexpr double SIGNAL_TOTAL_DURATION = M_TAU;
         constexpr size_t NUM_SAMPLES_SIGNAL = 100;
+        constexpr size_t NUM_BINS = (NUM_SAMPLES_SIGNAL/2) + 1;
         
-        static double x_coords_signal[NUM_SAMPLES_SIGNAL + 1] {};
-        static double y_coords_signal[NUM_SAMPLES_SIGNAL + 1] {};
+        static double x_coords_signal[NUM_SAMPLES_SIGNAL] {};
+        static double y_coords_signal[NUM_SAMPLES_SIGNAL] {};
+
+        static double x_coords_scatter[NUM_SAMPLES_SIGNAL] {};
+        static double y_coords_scatter[NUM_SAMPLES_SIGNAL] {};
 
-        static double x_coords_scatter[NUM_SAMPLES_SIGNAL + 1] {};
-        static double y_coords_scatter[NUM_SAMPLES_SIGNAL + 1] {};
+        static double frequency_spectrum[NUM_BINS] {};
+        static std::complex<double> complex_engergy_spectrum[NUM_BINS] {};
+        static double energy_spectrum[NUM_BINS] {};
 
-        static double frequency_spectrum[(NUM_SAMPLES_SIGNAL/2) + 1] {};
-        static std::complex<double> complex_engergy_spectrum[(NUM_SAMPLES_SIGNAL/2) + 1] {};
-        static double energy_spectrum[(NUM_SAMPLES_SIGNAL/2) + 1] {};
+        static double x_coords_ift_signal[NUM_SAMPLES_SIGNAL] {};
+        static double y_coords_ift_signal[NUM_SAMPLES_SIGNAL] {}; 
 
-        static double x_coords_ift_signal[NUM_SAMPLES_SIGNAL + 1] {};
-        static double y_coords_ift_signal[NUM_SAMPLES_SIGNAL + 1] {}; 
+        constexpr double sampling_rate = NUM_SAMPLES_SIGNAL / SIGNAL_TOTAL_DURATION;
         
         {
             static bool once {false};
             if (!once) {
                 {
-                    for (size_t i {0}; i <= NUM_SAMPLES_SIGNAL; i ++) {
+                    for (size_t i {0}; i < NUM_SAMPLES_SIGNAL; i ++) {
                         double signal_in = ((double)i/NUM_SAMPLES_SIGNAL) * SIGNAL_TOTAL_DURATION;
                         double signal_out = 
                             1.f * std::sin( 1.f * signal_in) + 
@@ -199,66 +536,53 @@ namespace Engine::Game {
                         y_coords_signal[i] = signal_out;
                     }    
                 }
+
+                {
+                    auto plan = FFT::get_real_plan<double>(NUM_SAMPLES_SIGNAL);
+                    plan->forward(y_coords_signal, complex_engergy_spectrum);
+                    plan->inverse(complex_engergy_spectrum, y_coords_ift_signal);
+
+                    for (size_t k {0}; k < NUM_BINS; k++) {
+                        complex_engergy_spectrum[k] /= static_cast<double>(NUM_SAMPLES_SIGNAL);
+                        frequency_spectrum[k] = (double)k * (sampling_rate / NUM_SAMPLES_SIGNAL);
+                    }
+
+                    for (size_t i {0}; i < NUM_SAMPLES_SIGNAL; i++) {
+                        x_coords_ift_signal[i] = x_coords_signal[i];
+                        y_coords_ift_signal[i] /= static_cast<double>(NUM_SAMPLES_SIGNAL);
+                    }
+                }
                 once = true;                    
             }
         }
 
         constexpr float DELTA_TIME_FOR_DESIRED_FPS = 1.f/20.f;
-        constexpr double sampling_rate = NUM_SAMPLES_SIGNAL / SIGNAL_TOTAL_DURATION;
-        constexpr double nyquist_frequency = sampling_rate / 2.0;
         static size_t j {0};
         
         static double x_coord_center_of_mass[1];
         static double y_coord_center_of_mass[1];
 
-        if (timer >= DELTA_TIME_FOR_DESIRED_FPS)
+        // the spectrum is known up front, only the winding of the current bin is animated
+        if (timer >= DELTA_TIME_FOR_DESIRED_FPS && j < NUM_BINS)
         {
-            static bool ift_done {false};
             timer = 0;
-            if (j <= NUM_SAMPLES_SIGNAL/2) {
-                double frequency = (double)j * (sampling_rate / NUM_SAMPLES_SIGNAL);
-                std::complex<double> sum(0, 0); 
-                
-                for (size_t i {0}; i <= NUM_SAMPLES_SIGNAL; i++) {
-                    double input = ((double)i/NUM_SAMPLES_SIGNAL) * SIGNAL_TOTAL_DURATION;
-                    std::complex<double> result = y_coords_signal[i] * Utils::complex_exp(-frequency, input);
-                    sum += result;
-                    x_coords_scatter[i] = result.real();
-                    y_coords_scatter[i] = result.imag();
-                }
-                
-                x_coord_center_of_mass[0] = sum.real() / (NUM_SAMPLES_SIGNAL + 1);
-                y_coord_center_of_mass[0] = sum.imag() / (NUM_SAMPLES_SIGNAL + 1);
-                
-                double magnitude = std::abs(sum);
-
-                frequency_spectrum[j] = frequency;
-                complex_engergy_spectrum[j] = sum / static_cast<double>(NUM_SAMPLES_SIGNAL + 1);
-                energy_spectrum[j] = magnitude / (NUM_SAMPLES_SIGNAL + 1);
-                j++;
-            }
-            else if (!ift_done) {
-                ift_done = true;
-                for (size_t i {0}; i <= NUM_SAMPLES_SIGNAL; i++) {
-                    double signal_in = ((double)i/NUM_SAMPLES_SIGNAL) * SIGNAL_TOTAL_DURATION;
-                    std::complex<double> sum_complex(0, 0);
-                    for (size_t k {0}; k <= NUM_SAMPLES_SIGNAL/2; k++) {
-                        double frequency = frequency_spectrum[k];
-                        std::complex<double> coefficient = complex_engergy_spectrum[k];
-                        double weight = (k == 0 || k == NUM_SAMPLES_SIGNAL/2) ? 1.0 : 2.0;
-                        sum_complex += weight * coefficient * Utils::complex_exp(frequency, signal_in);
-                    }
-                    
-                    x_coords_ift_signal[i] = signal_in;
-                    y_coords_ift_signal[i] = sum_complex.real();
-                }
+            for (size_t i {0}; i < NUM_SAMPLES_SIGNAL; i++) {
+                double phase = -M_TAU * static_cast<double>((i * j) % NUM_SAMPLES_SIGNAL) / NUM_SAMPLES_SIGNAL;
+                std::complex<double> result = y_coords_signal[i] * std::polar(1.0, phase);
+                x_coords_scatter[i] = result.real();
+                y_coords_scatter[i] = result.imag();
             }
+            
+            x_coord_center_of_mass[0] = complex_engergy_spectrum[j].real();
+            y_coord_center_of_mass[0] = complex_engergy_spectrum[j].imag();
+            energy_spectrum[j] = std::abs(complex_engergy_spectrum[j]);
+            j++;
         }
             
         if (ImGui::CollapsingHeader("graph-preview", ImGuiTreeNodeFlags_DefaultOpen)) {
             {
                 if (ImPlot::BeginPlot("forward-fourier-transform", ImVec2(300, 300), ImPlotFlags_Equal)) {
-                    ImPlot::PlotLine("line", x_coords_scatter, y_coords_scatter, NUM_SAMPLES_SIGNAL + 1);
+                    ImPlot::PlotLine("line", x_coords_scatter, y_coords_scatter, NUM_SAMPLES_SIGNAL);
                     ImPlot::PlotScatter("scatter", x_coord_center_of_mass, y_coord_center_of_mass, 1);
                     ImPlot::EndPlot();
                 }
@@ -266,7 +590,7 @@ namespace Engine::Game {
                 ImGui::SameLine();
 
                 if (ImPlot::BeginPlot("signal", ImVec2(300, 300), ImPlotFlags_Equal)) {
-                    ImPlot::PlotLine("line", x_coords_signal, y_coords_signal, NUM_SAMPLES_SIGNAL + 1);
+                    ImPlot::PlotLine("line", x_coords_signal, y_coords_signal, NUM_SAMPLES_SIGNAL);
                     ImPlot::EndPlot();
                 }
             }
@@ -274,13 +598,13 @@ namespace Engine::Game {
             ImGui::Spacing();
 
             {
-                if (ImPlot::BeginPlot("frequency-domain-spectrum (dft)", ImVec2(607, 200), ImPlotFlags_Equal)) {
-                    ImPlot::PlotLine("line", frequency_spectrum, energy_spectrum, (NUM_SAMPLES_SIGNAL/2) + 1);
+                if (ImPlot::BeginPlot("frequency-domain-spectrum (fft)", ImVec2(607, 200), ImPlotFlags_Equal)) {
+                    ImPlot::PlotLine("line", frequency_spectrum, energy_spectrum, static_cast<int>(j));
                     ImPlot::EndPlot();
                 }
 
-                if (ImPlot::BeginPlot("time-domain-spectrum (ift)", ImVec2(607, 200), ImPlotFlags_Equal)) {
-                    ImPlot::PlotLine("line", x_coords_ift_signal, y_coords_ift_signal, NUM_SAMPLES_SIGNAL + 1);
+                if (ImPlot::BeginPlot("time-domain-spectrum (ifft)", ImVec2(607, 200), ImPlotFlags_Equal)) {
+                    if (j == NUM_BINS) ImPlot::PlotLine("line", x_coords_ift_signal, y_coords_ift_signal, NUM_SAMPLES_SIGNAL);
                     ImPlot::EndPlot();
                 }
             }
@@ -342,7 +666,12 @@ namespace Engine::Game {
                 ImGui::Begin("viewport");
                 {
                     current_size = ImGui::GetContentRegionAvail();
-                    ImGui::Image((void*)(intptr_t)texture_framebuffer_color->get_id(), current_size, ImVec2(0, 1), ImVec2(1, 0));
+                    // only the viewport sub-rectangle of the bucket sized target holds the scene
+                    const ImVec2 uv(
+                        static_cast<float>(viewport_size.x) / texture_framebuffer_color->get_width(),
+                        static_cast<float>(viewport_size.y) / texture_framebuffer_color->get_height()
+                    );
+                    ImGui::Image((void*)(intptr_t)texture_framebuffer_color->get_id(), current_size, ImVec2(0, uv.y), ImVec2(uv.x, 0));
                 }
                 static ImVec2 last_size { ImVec2(0, 0) };
                 static bool once { false };
@@ -368,7 +697,13 @@ namespace Engine::Game {
                 {
                     draw_imgui_information_header(camera.get());
                     draw_imgui_camera_settings_header(camera.get());
-                    draw_imgui_ocean_settings_header();
+                    draw_imgui_ocean_settings_header(ocean.get(), clock.get_render_time());
+                    draw_imgui_simulation_clock_header(clock);
+                    draw_imgui_buoyancy_header(buoyancy.get());
+                    draw_imgui_clipmap_header(clipmap.get());
+                    draw_imgui_foam_header(foam_settings);
+                    draw_imgui_render_scale_header(render_scale_settings, render_scale, scaled_pass_ms, scene_size, viewport_size);
+                    draw_imgui_frame_graph_header(frame_graph.get());
                     draw_imgui_graph_preview_header();
                 }
                 ImGui::End();
@@ -377,30 +712,268 @@ namespace Engine::Game {
     }
 
     void Renderer::render() {
-        framebuffer->bind();
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        shaders["ocean"]
-            .set_uniform_mat4("model", glm::mat4(1.f))
-            .set_uniform_mat4("view", camera->get_matrix())
-            .set_uniform_mat4("projection", camera->get_projection())
-            .set_uniform_float("time", glfwGetTime())
-            .use();
-        vao->bind();
-        glDrawElements(GL_TRIANGLES, mesh_plane.indices.size(), GL_UNSIGNED_INT, 0);
+        render_scene();
+
+        Profiler::Scope scope("imgui-build", false);
+        draw_imgui();
+    }
+
+    void Renderer::update_render_scale() {
+        const RenderScaleSettings& settings = render_scale_settings;
+
+        // the frame graph times every pass; only the ones drawn at scene_size follow the pixel count, the square of the scale
+        scaled_pass_ms = Profiler::get_gpu_statistics("sky").last + Profiler::get_gpu_statistics("ocean").last;
+        if (buoyancy->get_count() > 0) scaled_pass_ms += Profiler::get_gpu_statistics("bodies").last;
+
+        if (!settings.dynamic) render_scale = settings.scale;
+        else if (scaled_pass_ms > 0.f) {
+            // the measurement trails by a few frames, so each frame only takes a step towards the scale that would meet
+            // the target, and a near miss is left alone
+            const float correction = std::sqrt(settings.target_ms / scaled_pass_ms);
+            if (std::abs(correction - 1.f) > .05f) render_scale *= std::clamp(1.f + (correction - 1.f) * .15f, .95f, 1.05f);
+        }
+
+        render_scale = std::clamp(render_scale, settings.min_scale, settings.max_scale);
+        scene_size = glm::max(glm::uvec2(glm::round(glm::vec2(viewport_size) * render_scale)), glm::uvec2(1));
+    }
+
+    void Renderer::render_scene() {
+        update_render_scale();
+        const bool temporal = render_scale_settings.temporal;
+        if (!temporal) history_frames = 0;
+
+        // a new sub-pixel offset every frame, the temporal pass takes it out again while it accumulates
+        const glm::vec2 jitter = temporal
+            ? glm::vec2(halton(history_frames % 8 + 1, 2), halton(history_frames % 8 + 1, 3)) - .5f
+            : glm::vec2(0.f);
+        const glm::mat4 jitter_matrix = glm::translate(glm::mat4(1.f), glm::vec3(2.f * jitter / glm::vec2(scene_size), 0.f));
+
+        const glm::mat4 view_projection = camera->get_projection() * camera->get_matrix();
+        if (history_frames == 0) previous_view_projection = view_projection;
+        // this frame's unjittered ndc and depth back into last frame's clip space
+        const glm::mat4 reprojection = previous_view_projection * glm::inverse(view_projection);
+        previous_view_projection = view_projection;
+
+        FrameData frame_data {
+            .view = camera->get_matrix(),
+            .projection = jitter_matrix * camera->get_projection(),
+            .camera_position = camera->position,
+            .time = static_cast<float>(clock.get_render_time())
+        };
+        frame_uniforms->data(&frame_data, sizeof(FrameData));
+        frame_uniforms->bind(Shader::FRAME_BLOCK_BINDING);
+
+        ocean->create_textures();
+        const OceanSettings& ocean_settings = ocean->get_settings();
+        const glm::uvec2 ocean_size(ocean_settings.resolution);
+
+        FrameGraph& graph = *frame_graph;
+        const FrameGraph::Resource output = graph.import_texture("viewport", texture_framebuffer_color, viewport_size);
+        const FrameGraph::Resource displacement = graph.import_texture("displacement", ocean->get_displacement_texture(), ocean_size);
+        const FrameGraph::Resource slope = graph.import_texture("slope", ocean->get_slope_texture(), ocean_size);
+        const FrameGraph::Resource foam = graph.import_texture("foam", ocean->get_foam_texture(), ocean_size);
+        graph.set_output(output);
+
+        // only frames where the clock crossed a step upload; the states they bring become current and the old ones previous.
+        // catch-up steps need no intermediate states since the spectrum is evaluated in closed form at any time
+        if (simulation_steps > 0) {
+            graph.add_pass("simulation",
+                [&](FrameGraph::Builder& builder) {
+                    builder.write(displacement, FrameGraph::Usage::Transfer);
+                    builder.write(slope, FrameGraph::Usage::Transfer);
+                },
+                [this](FrameGraph::Context&) {
+                    // uploads the step that ran on the workers since it was started and starts the one after the clock,
+                    // which then overlaps every frame until the clock reaches it
+                    ocean->upload();
+                    ocean->begin_simulation(clock.get_time() + clock.get_timestep());
+                }
+            );
+        }
+
+        // a single fused dispatch per uploaded cascade state: jacobian of the new displacement, injected into the decayed
+        // previous coverage. it runs after the simulation pass has flipped the layers, so the previous foam layer is the
+        // coverage of the state before
+        if (simulation_steps > 0) {
+            graph.add_pass("foam",
+                [&](FrameGraph::Builder& builder) {
+                    builder.read(displacement, FrameGraph::Usage::Sampled);
+                    builder.write(foam, FrameGraph::Usage::Image);
+                },
+                [this, ocean_size](FrameGraph::Context&) {
+                    const float lifetime = std::max(foam_settings.lifetime, 1e-3f);
+                    ocean->get_displacement_texture()->bind(0);
+                    shaders["foam"].set_uniform_float("foam_threshold", foam_settings.threshold);
+
+                    for (size_t i {0}; i < ocean->get_cascade_count(); i++) {
+                        if (!(ocean->get_uploaded_cascades() & (1u << i))) continue;
+                        shaders["foam"]
+                            .bind_image(0, *ocean->get_foam_texture(), GL_READ_WRITE, GL_R16F)
+                            .set_uniform_int("layer", static_cast<int>(ocean->get_current_layer(i)))
+                            .set_uniform_float("texel_size", ocean->get_settings().get_patch_size(i) / ocean_size.x)
+                            .set_uniform_float("foam_decay", std::exp(-static_cast<float>(ocean->get_upload_interval(i)) / lifetime))
+                            .dispatch_threads(ocean_size.x, ocean_size.y);
+                    }
+                }
+            );
+        }
+
+        FrameGraph::Resource scene_color {FrameGraph::NONE};
+        graph.add_pass("sky",
+            [&](FrameGraph::Builder& builder) {
+                scene_color = builder.create("scene-color", {GL_RGBA16F, scene_size});
+            },
+            [this, &scene_color](FrameGraph::Context& context) {
+                context.bind_framebuffer({scene_color});
+                glDisable(GL_DEPTH_TEST);
+                shaders["sky"].use();
+                fullscreen_vao->bind();
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                glEnable(GL_DEPTH_TEST);
+            }
+        );
+
+        FrameGraph::Resource scene_depth {FrameGraph::NONE};
+        graph.add_pass("ocean",
+            [&](FrameGraph::Builder& builder) {
+                builder.read(displacement, FrameGraph::Usage::Sampled);
+                builder.read(slope, FrameGraph::Usage::Sampled);
+                if (foam_settings.enabled) builder.read(foam, FrameGraph::Usage::Sampled);
+                builder.write(scene_color, FrameGraph::Usage::Attachment);
+                scene_depth = builder.create("scene-depth", {GL_DEPTH_COMPONENT24, scene_size});
+            },
+            [this, &scene_color, &scene_depth](FrameGraph::Context& context) {
+                context.bind_framebuffer({scene_color}, scene_depth);
+                glClear(GL_DEPTH_BUFFER_BIT);
+
+                ocean->get_displacement_texture()->bind(0);
+                ocean->get_slope_texture()->bind(1);
+                ocean->get_foam_texture()->bind(2);
+
+                std::array<float, OceanSettings::MAX_CASCADES> patch_sizes {};
+                std::array<int, OceanSettings::MAX_CASCADES> layers {};
+                std::array<float, OceanSettings::MAX_CASCADES> blends {};
+                std::array<float, OceanSettings::MAX_CASCADES> band_starts {};
+                for (size_t i {0}; i < ocean->get_cascade_count(); i++) {
+                    patch_sizes[i] = ocean->get_settings().get_patch_size(i);
+                    band_starts[i] = ocean->get_settings().get_band_start(i);
+                    layers[i] = static_cast<int>(ocean->get_current_layer(i));
+                    blends[i] = ocean->get_interpolation(clock.get_render_time(), i);
+                }
+
+                shaders["ocean"]
+                    .set_uniform_int("cascade_count", static_cast<int>(ocean->get_cascade_count()))
+                    .set_uniform_floats("cascade_patch_sizes", patch_sizes)
+                    .set_uniform_ints("cascade_layers", layers)
+                    .set_uniform_floats("cascade_blends", blends)
+                    .set_uniform_floats("cascade_band_starts", band_starts)
+                    .set_uniform_float("foam_enabled", foam_settings.enabled ? 1.f : 0.f);
+                clipmap->draw(shaders["ocean"]);
+            }
+        );
+
+        if (buoyancy->get_count() > 0) {
+            graph.add_pass("bodies",
+                [&](FrameGraph::Builder& builder) {
+                    builder.write(scene_color, FrameGraph::Usage::Attachment);
+                    builder.write(scene_depth, FrameGraph::Usage::Attachment);
+                },
+                [this, &scene_color, &scene_depth](FrameGraph::Context& context) {
+                    context.bind_framebuffer({scene_color}, scene_depth);
+                    buoyancy->draw(shaders["bodies"], clock.get_alpha());
+                }
+            );
+        }
+
+        // back to the viewport: the jittered scene is blended into the history reprojected through the camera matrices,
+        // with the history clamped to the scene's neighbourhood so disoccluded and moving water does not ghost
+        FrameGraph::Resource resolved {scene_color};
+        glm::uvec2 resolved_size {scene_size};
+        if (temporal) {
+            const FrameGraph::Resource history = graph.import_texture("history", texture_history[(history_frames + 1) % 2], viewport_size);
+            const FrameGraph::Resource accumulated = graph.import_texture("accumulated", texture_history[history_frames % 2], viewport_size);
+            const float history_weight = history_frames == 0 ? 0.f : render_scale_settings.history_weight;
+
+            graph.add_pass("temporal",
+                [&](FrameGraph::Builder& builder) {
+                    builder.read(scene_color, FrameGraph::Usage::Sampled);
+                    builder.read(scene_depth, FrameGraph::Usage::Sampled);
+                    builder.read(history, FrameGraph::Usage::Sampled);
+                    builder.write(accumulated, FrameGraph::Usage::Attachment);
+                },
+                [this, &scene_color, &scene_depth, history, accumulated, jitter, reprojection, history_weight](FrameGraph::Context& context) {
+                    context.bind_framebuffer({accumulated});
+                    glDisable(GL_DEPTH_TEST);
+                    context.get_texture(scene_color)->bind(0);
+                    context.get_texture(scene_depth)->bind(1);
+                    context.get_texture(history)->bind(2);
+                    shaders["temporal"]
+                        .set_uniform_vec2("scene_extent", glm::vec2(scene_size))
+                        .set_uniform_vec2("output_size", glm::vec2(viewport_size))
+                        .set_uniform_vec2("jitter", jitter)
+                        .set_uniform_mat4("reprojection", reprojection)
+                        .set_uniform_float("history_weight", history_weight)
+                        .use();
+                    fullscreen_vao->bind();
+                    glDrawArrays(GL_TRIANGLES, 0, 3);
+                    glEnable(GL_DEPTH_TEST);
+                }
+            );
+
+            resolved = accumulated;
+            resolved_size = viewport_size;
+            history_frames++;
+        }
+
+        graph.add_pass("post",
+            [&](FrameGraph::Builder& builder) {
+                builder.read(resolved, FrameGraph::Usage::Sampled);
+                builder.write(output, FrameGraph::Usage::Attachment);
+            },
+            [this, resolved, resolved_size, output](FrameGraph::Context& context) {
+                context.bind_framebuffer({output});
+                glDisable(GL_DEPTH_TEST);
+                context.get_texture(resolved)->bind(0);
+                shaders["post"]
+                    .set_uniform_vec2("source_extent", glm::vec2(resolved_size))
+                    .set_uniform_vec2("output_size", glm::vec2(viewport_size))
+                    .use();
+                fullscreen_vao->bind();
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                glEnable(GL_DEPTH_TEST);
+            }
+        );
+
+        graph.execute();
         Shader::unuse();
+    }
 
-        FBO::unbind();
+    Ocean* Renderer::get_ocean() {
+        return ocean.get();
+    }
 
-        draw_imgui();
+    Clipmap* Renderer::get_clipmap() {
+        return clipmap.get();
+    }
+
+    Buoyancy* Renderer::get_buoyancy() {
+        return buoyancy.get();
+    }
+
+    Time::SimulationClock& Renderer::get_clock() {
+        return clock;
+    }
+
+    double Renderer::get_shader_startup_ms() {
+        return shader_startup_ms;
     }
 
     void Renderer::refactor(int width, int height) {
         out("refactor: (width={}; height={})", width, height);
         if (width <= 0 || height <= 0) return;
-        glViewport(0, 0, width, height);
-        framebuffer->refactor(width, height);
+        viewport_size = glm::uvec2(width, height);
+        resize_framebuffer(viewport_size);
+        history_frames = 0;
         camera->refactor(width, height);
     }
 }
\ No newline at end of file